@@ -7,22 +7,44 @@
 #include <errno.h>
 #include <unistd.h>
 
-static int createNonblocking(){
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+static int createNonblocking(sa_family_t family){
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if(sockfd < 0){
         LOG_FATAL("%s:%s:%d listen socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
     }
     return sockfd;
 }
 
+// 上次进程退出后留下的socket文件: 连不上(ECONNREFUSED)说明没有进程在监听,可以删除
+// 连上了说明另一个进程正在使用这个路径,不能删,随后的bind会报错
+static bool staleUnixSocket(const InetAddress &addr){
+    int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sockfd < 0){
+        return false;
+    }
+    bool stale = ::connect(sockfd, addr.getSockAddr(), addr.getSockLen()) < 0 && errno == ECONNREFUSED;
+    ::close(sockfd);
+    return stale;
+}
+
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport)
     : loop_(loop)
-    , acceptSocket_(createNonblocking()) 
+    , acceptSocket_(createNonblocking(listenAddr.family())) 
     , acceptChannel_(loop, acceptSocket_.fd())
+    , listenAddr_(listenAddr)
     , listenning_(false)
 {
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    if(listenAddr.isUnix()){
+        // 文件系统中的Unix域socket文件在上次进程退出后可能还在,确认没有进程在监听后bind前删除
+        std::string path = listenAddr.unixPath();
+        if(!path.empty() && path[0] != '@' && staleUnixSocket(listenAddr)){
+            ::unlink(path.c_str());
+        }
+    }
+    else{
+        acceptSocket_.setReuseAddr(true);
+        acceptSocket_.setReusePort(true);
+    }
     acceptSocket_.bindAddress(listenAddr); 
     // baseLoop监听到acceptChannel_(listenfd)的读事件(即有新连接) => 执行handleRead回调
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
@@ -31,6 +53,10 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
 Acceptor::~Acceptor(){
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    std::string path = listenAddr_.unixPath();
+    if(!path.empty() && path[0] != '@'){
+        ::unlink(path.c_str());
+    }
 }
 
 // mainloop开始监听新连接
@@ -3,11 +3,11 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "InetAddress.h"
 
 #include <functional>
 
 class EventLoop;
-class InetAddress;
 
 class Acceptor : noncopyable{
 public:
@@ -27,6 +27,7 @@ private:
     EventLoop *loop_; // mainloop = baseloop
     Socket acceptSocket_; 
     Channel acceptChannel_; 
+    const InetAddress listenAddr_;
     NewConnectionCallback newConnectionCallback_;
     bool listenning_;
 };
\ No newline at end of file
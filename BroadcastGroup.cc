@@ -0,0 +1,91 @@
+#include "BroadcastGroup.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+
+#include <algorithm>
+
+void BroadcastGroup::add(const TcpConnectionPtr &conn){
+    std::unique_lock<std::mutex> lock(mutex_);
+    ConnectionListPtr &list = members_[conn->getloop()];
+    if(!list){
+        list = std::make_shared<ConnectionList>();
+    }
+    else if(list.use_count() > 1){
+        list = std::make_shared<ConnectionList>(*list);
+    }
+    list->push_back(conn);
+    ++size_;
+}
+
+void BroadcastGroup::remove(const TcpConnectionPtr &conn){
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = members_.find(conn->getloop());
+    if(it == members_.end()){
+        return;
+    }
+    ConnectionListPtr &list = it->second;
+    auto pos = std::find(list->begin(), list->end(), conn);
+    if(pos == list->end()){
+        return;
+    }
+    if(list.use_count() > 1){
+        size_t index = pos - list->begin();
+        list = std::make_shared<ConnectionList>(*list);
+        pos = list->begin() + index;
+    }
+    // 订阅者之间没有顺序,用最后一个填补空位
+    *pos = std::move(list->back());
+    list->pop_back();
+    --size_;
+    if(list->empty()){
+        members_.erase(it);
+    }
+}
+
+size_t BroadcastGroup::size() const{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void BroadcastGroup::send(const Payload &payload){
+    if(!payload || payload->empty()){
+        return;
+    }
+    // 在锁外投递,只持有列表的引用
+    std::vector<std::pair<EventLoop *, std::shared_ptr<const ConnectionList>>> batches;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batches.reserve(members_.size());
+        for(auto &item : members_){
+            batches.emplace_back(item.first, item.second);
+        }
+    }
+    for(auto &batch : batches){
+        batch.first->runInLoop(std::bind(&BroadcastGroup::sendInLoop, batch.second, payload));
+    }
+}
+
+void BroadcastGroup::send(const std::vector<TcpConnectionPtr> &conns, const Payload &payload){
+    if(!payload || payload->empty()){
+        return;
+    }
+    std::unordered_map<EventLoop *, ConnectionListPtr> batches;
+    for(const TcpConnectionPtr &conn : conns){
+        ConnectionListPtr &list = batches[conn->getloop()];
+        if(!list){
+            list = std::make_shared<ConnectionList>();
+        }
+        list->push_back(conn);
+    }
+    for(auto &batch : batches){
+        batch.first->runInLoop(std::bind(&BroadcastGroup::sendInLoop,
+                                         std::shared_ptr<const ConnectionList>(std::move(batch.second)), payload));
+    }
+}
+
+// 在loop线程中执行,TcpConnection::send直接发送,不再经过任务队列
+void BroadcastGroup::sendInLoop(const std::shared_ptr<const ConnectionList> &conns, const Payload &payload){
+    for(const TcpConnectionPtr &conn : *conns){
+        conn->send(payload);
+    }
+}
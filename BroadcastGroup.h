@@ -0,0 +1,45 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "ScatterMessage.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class EventLoop;
+
+/**
+ * 把同一份消息发送给一组连接(发布订阅中一个主题的所有订阅者)
+ * 订阅者按所属loop分组,每次发送只向每个loop投递一个任务,由它在loop线程中依次发送给本loop的订阅者;
+ * 所有连接共享同一份引用计数的payload,跨线程投递与没写完的部分都不拷贝数据
+ * add/remove/send可以在任意线程调用
+ */
+class BroadcastGroup : noncopyable{
+public:
+    using Payload = ScatterMessage::Slice;
+
+    BroadcastGroup() : size_(0) {}
+
+    void add(const TcpConnectionPtr &conn);
+    void remove(const TcpConnectionPtr &conn);
+    size_t size() const;
+
+    void send(const Payload &payload);
+
+    // 发送给一组临时的连接,每次调用时按loop分组
+    static void send(const std::vector<TcpConnectionPtr> &conns, const Payload &payload);
+
+private:
+    using ConnectionList = std::vector<TcpConnectionPtr>;
+    using ConnectionListPtr = std::shared_ptr<ConnectionList>;
+
+    static void sendInLoop(const std::shared_ptr<const ConnectionList> &conns, const Payload &payload);
+
+    mutable std::mutex mutex_;
+    // 每个loop的订阅者列表. 写时复制: 正在被投递的任务引用的列表不再修改
+    std::unordered_map<EventLoop *, ConnectionListPtr> members_;
+    size_t size_;
+};
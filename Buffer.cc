@@ -3,18 +3,24 @@
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <algorithm>
 
 // 从fd读数据,读到buffer中
-ssize_t Buffer::readFd(int fd, int *saveErrno){
+ssize_t Buffer::readFd(int fd, int *saveErrno, size_t maxBytes){
     char extrabuf[65536] = {0}; // 栈上的内存空间 64k
     struct iovec vec[2];
-    const size_t writable = writableBytes(); // Buffer底层缓冲区剩余的可写空间大小
+    size_t writable = writableBytes(); // Buffer底层缓冲区剩余的可写空间大小
+    size_t extra = sizeof(extrabuf);
+    if(maxBytes > 0){ // 限制本次读取量,剩下的留在内核缓冲区
+        writable = std::min(writable, maxBytes);
+        extra = std::min(extra, maxBytes - writable);
+    }
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    vec[1].iov_len = extra;
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    const int iovcnt = (writable < sizeof(extrabuf) && extra > 0) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
     if(n < 0){
         *saveErrno = errno;
@@ -23,7 +29,7 @@ ssize_t Buffer::readFd(int fd, int *saveErrno){
         writerIndex_ += n;
     }
     else{
-        writerIndex_ = buffer_.size();
+        writerIndex_ += writable;
         append(extrabuf, n - writable);
     }
     return n;
@@ -4,6 +4,9 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
 
 /*
 内存布局 : [prependable(前缀预留)][writable(可写入区域)]
@@ -58,6 +61,12 @@ public:
         readerIndex_ = writerIndex_ = kCheapPrepend;
     }
 
+    // 以下整数读写均使用网络字节序
+    void retrieveInt64() { retrieve(sizeof(int64_t)); }
+    void retrieveInt32() { retrieve(sizeof(int32_t)); }
+    void retrieveInt16() { retrieve(sizeof(int16_t)); }
+    void retrieveInt8() { retrieve(sizeof(int8_t)); }
+
     std::string retrieveAllAsString() { 
         return retrieveAsString(readableBytes()); 
     }
@@ -81,11 +90,85 @@ public:
         writerIndex_ += len;
     }
 
+    void appendInt64(int64_t x){
+        int64_t be64 = htobe64(x);
+        append(reinterpret_cast<const char *>(&be64), sizeof(be64));
+    }
+    void appendInt32(int32_t x){
+        int32_t be32 = htobe32(x);
+        append(reinterpret_cast<const char *>(&be32), sizeof(be32));
+    }
+    void appendInt16(int16_t x){
+        int16_t be16 = htobe16(x);
+        append(reinterpret_cast<const char *>(&be16), sizeof(be16));
+    }
+    void appendInt8(int8_t x){
+        append(reinterpret_cast<const char *>(&x), sizeof(x));
+    }
+
+    // 要求 readableBytes() >= sizeof(intN_t)
+    int64_t peekInt64() const{
+        int64_t be64 = 0;
+        ::memcpy(&be64, peek(), sizeof(be64));
+        return be64toh(be64);
+    }
+    int32_t peekInt32() const{
+        int32_t be32 = 0;
+        ::memcpy(&be32, peek(), sizeof(be32));
+        return be32toh(be32);
+    }
+    int16_t peekInt16() const{
+        int16_t be16 = 0;
+        ::memcpy(&be16, peek(), sizeof(be16));
+        return be16toh(be16);
+    }
+    int8_t peekInt8() const{
+        return *peek();
+    }
+
+    int64_t readInt64() { int64_t result = peekInt64(); retrieveInt64(); return result; }
+    int32_t readInt32() { int32_t result = peekInt32(); retrieveInt32(); return result; }
+    int16_t readInt16() { int16_t result = peekInt16(); retrieveInt16(); return result; }
+    int8_t readInt8() { int8_t result = peekInt8(); retrieveInt8(); return result; }
+
+    // 把数据写入可读数据之前的prependable区域(协议头)
+    // prependable区域不够时(默认只有kCheapPrepend字节)在头部扩出空间,把数据整体后移
+    void prepend(const void *data, size_t len){
+        if(len > prependableBytes()){
+            size_t grow = len - prependableBytes() + kCheapPrepend;
+            buffer_.insert(buffer_.begin(), grow, 0);
+            readerIndex_ += grow;
+            writerIndex_ += grow;
+        }
+        readerIndex_ -= len;
+        const char *d = static_cast<const char *>(data);
+        std::copy(d, d + len, begin() + readerIndex_);
+    }
+    void prependInt64(int64_t x){
+        int64_t be64 = htobe64(x);
+        prepend(&be64, sizeof(be64));
+    }
+    void prependInt32(int32_t x){
+        int32_t be32 = htobe32(x);
+        prepend(&be32, sizeof(be32));
+    }
+    void prependInt16(int16_t x){
+        int16_t be16 = htobe16(x);
+        prepend(&be16, sizeof(be16));
+    }
+    void prependInt8(int8_t x){
+        prepend(&x, sizeof(x));
+    }
+
     char *beginWrite() { return begin() + writerIndex_; }
 
     const char *beginWrite() const { return begin() + writerIndex_; }
 
-    ssize_t readFd(int fd, int *saveErrno);
+    // 直接写入beginWrite()之后,登记写入的字节数,要求 len <= writableBytes()
+    void hasWritten(size_t len) { writerIndex_ += len; }
+
+    // maxBytes为0时不限制一次读取的字节数
+    ssize_t readFd(int fd, int *saveErrno, size_t maxBytes = 0);
 
     ssize_t writeFd(int fd, int *saveErrno);
 
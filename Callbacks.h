@@ -13,4 +13,13 @@ using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback = std::function<void(TcpConnectionPtr &, size_t)>;
-using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
\ No newline at end of file
+using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
+// 一个TcpServer/TcpClient的所有连接共享同一份回调,不必每个连接各拷贝一份std::function
+struct ConnectionCallbacks{
+    ConnectionCallback connectionCallback;       // 连接状态变化的回调(建立或断开)
+    MessageCallback messageCallback;             // 收到新数据并存入inputBuffer_后触发此回调
+    WriteCompleteCallback writeCompleteCallback; // 数据全部发送完成后的回调
+    HighWaterMarkCallback highWaterMarkCallback; // 待发送数据超过阈值时触发
+    CloseCallback closeCallback;                 // 连接关闭时触发
+};
+using ConnectionCallbacksPtr = std::shared_ptr<ConnectionCallbacks>;
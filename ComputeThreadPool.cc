@@ -0,0 +1,223 @@
+#include "ComputeThreadPool.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <unistd.h>
+
+// 当前线程是本线程池的第几个计算线程,不是计算线程时为-1
+static thread_local const ComputeThreadPool *t_pool = nullptr;
+static thread_local int t_workerIndex = -1;
+
+ComputeThreadPool::ComputeThreadPool(const std::string &name)
+    : name_(name)
+    , numThreads_(static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN)))
+    , running_(false)
+    , pendingTasks_(0)
+    , next_(0)
+    , numSleeping_(0)
+{}
+
+ComputeThreadPool::~ComputeThreadPool(){
+    stop();
+}
+
+void ComputeThreadPool::start(){
+    if(running_){
+        return;
+    }
+    running_ = true;
+    if(numThreads_ <= 0){
+        numThreads_ = 1;
+    }
+    // stop之后再次start: 旧的线程都已join,任务也都执行完了,换一组新的Worker
+    workers_.clear();
+    for(int i = 0; i < numThreads_; ++i){
+        workers_.emplace_back(new Worker);
+    }
+    for(int i = 0; i < numThreads_; ++i){
+        workers_[i]->thread.reset(new Thread(std::bind(&ComputeThreadPool::workerFunc, this, i),
+                                             name_ + std::to_string(i)));
+        workers_[i]->thread->start();
+    }
+}
+
+void ComputeThreadPool::stop(){
+    if(!running_.exchange(false)){
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        for(auto &worker : workers_){
+            worker->cond.notify_one();
+        }
+    }
+    for(auto &worker : workers_){
+        worker->thread->join();
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleeping_.clear();
+    numSleeping_ = 0;
+}
+
+void ComputeThreadPool::run(Task task, uint64_t affinity){
+    push(std::move(task), affinity);
+}
+
+void ComputeThreadPool::submit(EventLoop *loop, Task work, Task done, uint64_t affinity){
+    CompletionQueuePtr queue = completionQueueOf(loop);
+    push([queue, work, done](){
+        work();
+        complete(queue, done);
+    }, affinity);
+}
+
+void ComputeThreadPool::push(Task task, uint64_t affinity){
+    if(!running_){
+        // stop期间计算线程还在执行剩下的任务,它们提交的任务直接执行,免得交给已经退出的线程
+        if(t_pool == this){
+            task();
+            return;
+        }
+        // start之前或stop之后没有线程执行它
+        LOG_FATAL("%s:%s:%d ComputeThreadPool[%s] is not running \n", __FILE__, __FUNCTION__, __LINE__, name_.c_str());
+    }
+    if(affinity != kNoAffinity){
+        int index = static_cast<int>(affinity % workers_.size());
+        Worker &worker = *workers_[index];
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.pinned.push_back(std::move(task));
+        }
+        ++worker.pinnedCount;
+        if(numSleeping_ > 0){
+            wakeup(index);
+        }
+        return;
+    }
+
+    // 计算线程自己提交的任务放入自己的队列(局部性好),外部线程提交的轮询分配
+    int index = (t_pool == this) ? t_workerIndex : static_cast<int>(next_++ % workers_.size());
+    Worker &worker = *workers_[index];
+    {
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    ++pendingTasks_;
+    if(numSleeping_ > 0){
+        wakeup(-1);
+    }
+}
+
+// 唤醒index号线程; index为-1时唤醒任意一个睡眠中的线程来执行或窃取任务
+void ComputeThreadPool::wakeup(int index){
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    if(index < 0){
+        if(!sleeping_.empty()){
+            workers_[sleeping_.back()]->cond.notify_one();
+        }
+    }
+    else if(std::find(sleeping_.begin(), sleeping_.end(), index) != sleeping_.end()){
+        workers_[index]->cond.notify_one();
+    }
+}
+
+// 依次尝试: 自己的affinity任务 -> 自己的队列头部 -> 从其他线程的队列尾部窃取
+bool ComputeThreadPool::takeTask(int index, Task *task){
+    Worker &self = *workers_[index];
+    if(self.pinnedCount > 0){
+        std::unique_lock<std::mutex> lock(self.mutex);
+        if(!self.pinned.empty()){
+            *task = std::move(self.pinned.front());
+            self.pinned.pop_front();
+            --self.pinnedCount;
+            return true;
+        }
+    }
+    if(pendingTasks_ == 0){
+        return false;
+    }
+    {
+        std::unique_lock<std::mutex> lock(self.mutex);
+        if(!self.tasks.empty()){
+            *task = std::move(self.tasks.front());
+            self.tasks.pop_front();
+            --pendingTasks_;
+            return true;
+        }
+    }
+    int n = static_cast<int>(workers_.size());
+    for(int i = 1; i < n; ++i){
+        Worker &victim = *workers_[(index + i) % n];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()){
+            *task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            --pendingTasks_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ComputeThreadPool::workerFunc(int index){
+    t_pool = this;
+    t_workerIndex = index;
+    Worker &self = *workers_[index];
+    Task task;
+    while(true){
+        if(takeTask(index, &task)){
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        // 先登记为睡眠再检查条件: 提交者要么看到任务已被取走,要么看到numSleeping_>0而来唤醒
+        sleeping_.push_back(index);
+        ++numSleeping_;
+        self.cond.wait(lock, [this, &self](){
+            return !running_ || pendingTasks_ > 0 || self.pinnedCount > 0;
+        });
+        --numSleeping_;
+        sleeping_.erase(std::find(sleeping_.begin(), sleeping_.end(), index));
+        if(!running_ && pendingTasks_ == 0 && self.pinnedCount == 0){
+            break;
+        }
+    }
+}
+
+ComputeThreadPool::CompletionQueuePtr ComputeThreadPool::completionQueueOf(EventLoop *loop){
+    std::unique_lock<std::mutex> lock(completionMutex_);
+    CompletionQueuePtr &queue = completionQueues_[loop];
+    if(!queue){
+        queue = std::make_shared<CompletionQueue>();
+        queue->loop = loop;
+    }
+    return queue;
+}
+
+// 队列由空变为非空时才向loop投递一次drain,之后到达的完成回调搭同一次投递
+void ComputeThreadPool::complete(const CompletionQueuePtr &queue, Task done){
+    bool post = false;
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        queue->dones.push_back(std::move(done));
+        post = !queue->posted;
+        queue->posted = true;
+    }
+    if(post){
+        queue->loop->queueInLoop(std::bind(&ComputeThreadPool::drain, queue));
+    }
+}
+
+void ComputeThreadPool::drain(const CompletionQueuePtr &queue){
+    std::vector<Task> dones;
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        dones.swap(queue->dones);
+        queue->posted = false;
+    }
+    for(const Task &done : dones){
+        done();
+    }
+}
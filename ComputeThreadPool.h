@@ -0,0 +1,96 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+class EventLoop;
+
+/**
+ * 计算线程池: 把CPU密集的工作(解析、压缩、加解密)从IO loop中移出去
+ * - 每个计算线程有自己的任务队列,自己的队列空了就从其他线程的队列尾部窃取任务
+ * - 带affinity的任务固定交给 affinity % 线程数 号线程执行且不可被窃取,同一affinity(如同一连接)的任务按提交顺序串行执行
+ * - submit的完成回调回到提交时指定的loop执行; 同一loop的完成回调攒成一批,一批只queueInLoop一次
+ */
+class ComputeThreadPool : noncopyable {
+public:
+    using Task = std::function<void()>;
+
+    static const uint64_t kNoAffinity = UINT64_MAX;
+
+    explicit ComputeThreadPool(const std::string &name = std::string("ComputeThreadPool"));
+    ~ComputeThreadPool();
+
+    // 需在start之前设置,默认为CPU核数
+    void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    void start();
+    void stop();
+
+    // 在计算线程中执行task,可在任意线程调用; 需在start之后、stop之前调用
+    void run(Task task, uint64_t affinity = kNoAffinity);
+
+    // 在计算线程中执行work,完成后在loop线程中执行done
+    void submit(EventLoop *loop, Task work, Task done, uint64_t affinity = kNoAffinity);
+
+    // work的返回值交给loop线程中的done; R需可默认构造
+    template <typename R>
+    void submit(EventLoop *loop, std::function<R()> work, std::function<void(R &)> done,
+                uint64_t affinity = kNoAffinity){
+        std::shared_ptr<R> result = std::make_shared<R>();
+        submit(loop, [result, work](){ *result = work(); }, [result, done](){ done(*result); }, affinity);
+    }
+
+    // 以连接对象的地址作为affinity,保证同一连接的任务有序
+    static uint64_t affinityOf(const void *object) { return reinterpret_cast<uintptr_t>(object); }
+
+private:
+    struct Worker{
+        std::unique_ptr<Thread> thread;
+        std::mutex mutex;
+        std::deque<Task> tasks;  // 可被窃取的任务
+        std::deque<Task> pinned; // 带affinity的任务,只由本线程执行
+        std::atomic_int pinnedCount{0};
+        std::condition_variable cond;
+    };
+
+    // 一个loop的完成回调队列
+    struct CompletionQueue{
+        EventLoop *loop;
+        std::mutex mutex;
+        std::vector<Task> dones;
+        bool posted = false; // 是否已向loop投递了一次drain
+    };
+    using CompletionQueuePtr = std::shared_ptr<CompletionQueue>;
+
+    void workerFunc(int index);
+    bool takeTask(int index, Task *task);
+    void push(Task task, uint64_t affinity);
+    void wakeup(int index);
+    CompletionQueuePtr completionQueueOf(EventLoop *loop);
+    static void complete(const CompletionQueuePtr &queue, Task done);
+    static void drain(const CompletionQueuePtr &queue);
+
+    const std::string name_;
+    int numThreads_;
+    std::atomic_bool running_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic_int pendingTasks_; // 所有可被窃取的任务个数
+    std::atomic_uint next_;        // 外部线程提交时轮询选择队列
+
+    std::mutex sleepMutex_;
+    std::atomic_int numSleeping_;
+    std::vector<int> sleeping_; // 正在睡眠的线程编号,受sleepMutex_保护
+
+    std::mutex completionMutex_;
+    std::unordered_map<EventLoop *, CompletionQueuePtr> completionQueues_;
+};
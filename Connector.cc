@@ -0,0 +1,185 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <sys/socket.h>
+#include <errno.h>
+#include <unistd.h>
+#include <strings.h>
+
+static int createNonblocking(sa_family_t family){
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(sockfd < 0){
+        LOG_FATAL("%s:%s:%d connect socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+static int getSocketError(int sockfd){
+    int optval;
+    socklen_t optlen = sizeof(optval);
+    if(::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0){
+        return errno;
+    }
+    return optval;
+}
+
+// 连接本机时,内核选的临时端口可能恰好等于目标端口,造成自连接
+static bool isSelfConnect(int sockfd){
+    sockaddr_in local, peer;
+    socklen_t addrlen = sizeof(local);
+    bzero(&local, sizeof(local));
+    bzero(&peer, sizeof(peer));
+    ::getsockname(sockfd, (sockaddr *)&local, &addrlen);
+    addrlen = sizeof(peer);
+    ::getpeername(sockfd, (sockaddr *)&peer, &addrlen);
+    return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , retryDelayMs_(kInitRetryDelayMs)
+    , retryTimer_(0)
+{
+    LOG_DEBUG("Connector ctor[%p] \n", this);
+}
+
+Connector::~Connector(){
+    LOG_DEBUG("Connector dtor[%p] \n", this);
+}
+
+void Connector::start(){
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop(){
+    retryTimer_ = 0;
+    if(connect_ && state_ == kDisconnected){
+        connect();
+    }
+}
+
+void Connector::stop(){
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop(){
+    if(retryTimer_ != 0){
+        loop_->cancel(retryTimer_);
+        retryTimer_ = 0;
+    }
+    if(state_ == kConnecting){
+        setState(kDisconnected);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+    }
+}
+
+// 连接断开后由TcpClient在loop线程中调用,重新开始连接
+void Connector::restart(){
+    setState(kDisconnected);
+    retryDelayMs_ = kInitRetryDelayMs;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::connect(){
+    int sockfd = createNonblocking(serverAddr_.family());
+    int ret = ::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.getSockLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch(savedErrno){
+    case 0:
+    case EINPROGRESS: // 非阻塞connect正在进行,等待可写事件
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+        retry(sockfd);
+        break;
+
+    default:
+        LOG_ERROR("Connector::connect to %s err:%d \n", serverAddr_.toIpPort().c_str(), savedErrno);
+        ::close(sockfd);
+        break;
+    }
+}
+
+void Connector::connecting(int sockfd){
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting(); // 连接建立(或失败)时sockfd可写
+}
+
+// 连接已有结果,channel不再需要; 当前正处于channel的回调中,所以延迟到下一轮再释放channel
+int Connector::removeAndResetChannel(){
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel(){
+    channel_.reset();
+}
+
+void Connector::handleWrite(){
+    if(state_ == kConnecting){
+        int sockfd = removeAndResetChannel();
+        int err = getSocketError(sockfd);
+        if(err){
+            LOG_ERROR("Connector::handleWrite - SO_ERROR = %d \n", err);
+            retry(sockfd);
+        }
+        else if(!serverAddr_.isUnix() && isSelfConnect(sockfd)){
+            LOG_ERROR("Connector::handleWrite - self connect \n");
+            retry(sockfd);
+        }
+        else{
+            setState(kConnected);
+            retryDelayMs_ = kInitRetryDelayMs;
+            if(connect_){
+                newConnectionCallback_(sockfd);
+            }
+            else{
+                ::close(sockfd);
+            }
+        }
+    }
+}
+
+void Connector::handleError(){
+    if(state_ == kConnecting){
+        int sockfd = removeAndResetChannel();
+        int err = getSocketError(sockfd);
+        LOG_ERROR("Connector::handleError - SO_ERROR = %d \n", err);
+        retry(sockfd);
+    }
+}
+
+void Connector::retry(int sockfd){
+    ::close(sockfd);
+    setState(kDisconnected);
+    if(connect_){
+        LOG_INFO("Connector::retry - retry connecting to %s in %d milliseconds \n",
+                 serverAddr_.toIpPort().c_str(), retryDelayMs_);
+        retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0,
+                                      std::bind(&Connector::startInLoop, shared_from_this()));
+        retryDelayMs_ = std::min(retryDelayMs_ * 2, static_cast<int>(kMaxRetryDelayMs));
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerQueue.h"
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+class Channel;
+class EventLoop;
+
+/**
+ * 主动发起连接: 非阻塞connect,返回EINPROGRESS时注册Channel的可写事件,
+ * 可写后用SO_ERROR判断连接是否成功; 失败后用loop的定时器按指数退避重试
+ */
+class Connector : noncopyable, public std::enable_shared_from_this<Connector> {
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    static const int kInitRetryDelayMs = 500;
+    static const int kMaxRetryDelayMs = 30 * 1000;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+
+    const InetAddress &serverAddress() const { return serverAddr_; }
+
+    void start();   // 可在任意线程调用
+    void restart(); // 只能在loop线程调用
+    void stop();    // 可在任意线程调用
+
+private:
+    enum States { kDisconnected, kConnecting, kConnected };
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_; // 用户是否希望保持连接
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_; // 正在连接中的sockfd对应的channel
+    NewConnectionCallback newConnectionCallback_;
+    int retryDelayMs_;
+    TimerId retryTimer_; // 等待中的重试定时器,没有时为0
+};
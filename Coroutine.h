@@ -0,0 +1,259 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "Coroutine.h requires -std=c++20"
+#endif
+
+#include "noncopyable.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+
+/**
+ * 基于C++20协程的连接读写接口,免去在MessageCallback中手工维护解析状态
+ *
+ *   coro::Task session(coro::ConnectionPtr conn){
+ *       while(true){
+ *           std::string line = co_await conn->readUntil("\r\n");
+ *           if(line.empty()) co_return; // 连接已断开
+ *           co_await conn->write(line);
+ *       }
+ *   }
+ *   coro::Connection::serve(server, session);
+ *
+ * 读写等待的协程直接在Channel::handleEvent => TcpConnection::handleRead/写完成回调中恢复执行,
+ * 等待者保存在协程帧内,每次co_await不额外分配内存
+ * read/readUntil/write必须在连接所属的loop线程中co_await;若用post切到了其他loop,需先post回来
+ * 本头文件只有使用者需以-std=c++20编译,库本身不依赖
+ */
+namespace coro{
+
+// 立即开始执行、执行完自行销毁的协程
+struct Task{
+    struct promise_type{
+        Task get_return_object() { return Task(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+class Connection;
+using ConnectionPtr = std::shared_ptr<Connection>;
+using Handler = std::function<Task(ConnectionPtr)>;
+
+class Connection : noncopyable{
+public:
+    // read(n)/readUntil(delim)的等待者: 数据足够时返回取出的数据,连接断开时返回空串
+    class ReadAwaiter{
+    public:
+        ReadAwaiter(Connection *conn, size_t n, std::string delim)
+            : conn_(conn), n_(n), delim_(std::move(delim)), scanned_(0), len_(0)
+        {}
+
+        bool await_ready() { return satisfied(); }
+        void await_suspend(std::coroutine_handle<> h){
+            conn_->reader_ = h;
+            conn_->readAwaiter_ = this;
+        }
+        std::string await_resume(){
+            if(len_ == 0){
+                return std::string();
+            }
+            Buffer *buf = conn_->conn_->inputBuffer();
+            std::string result(buf->peek(), len_);
+            buf->retrieve(len_);
+            return result;
+        }
+
+        // 判断inputBuffer中的数据能否满足本次读取,记下要取出的长度
+        bool satisfied(){
+            Buffer *buf = conn_->conn_->inputBuffer();
+            if(delim_.empty()){
+                if(buf->readableBytes() >= n_){ // read(0)立即完成,返回空串
+                    len_ = n_;
+                    return true;
+                }
+            }
+            else if(buf->readableBytes() >= delim_.size()){
+                // 从上次扫描到的位置继续查找,避免每收到一段数据就从头扫描
+                const char *begin = buf->peek() + scanned_;
+                const char *end = buf->peek() + buf->readableBytes();
+                const char *pos = std::search(begin, end, delim_.begin(), delim_.end());
+                if(pos != end){
+                    len_ = pos - buf->peek() + delim_.size();
+                    return true;
+                }
+                scanned_ = buf->readableBytes() - delim_.size() + 1;
+            }
+            return conn_->closed_;
+        }
+
+    private:
+        Connection *conn_;
+        size_t n_;
+        std::string delim_;
+        size_t scanned_; // 已确认不含分隔符的前缀长度
+        size_t len_;     // 满足条件时要取出的字节数
+    };
+
+    // write的等待者: outputBuffer发送完时恢复,返回false表示连接已断开
+    // 写完成回调由serve统一设置(TcpServer的连接共享同一份回调),只有writer_不为空时才恢复协程
+    class WriteAwaiter{
+    public:
+        explicit WriteAwaiter(Connection *conn) : conn_(conn) {}
+
+        bool await_ready() const { return conn_->closed_ || conn_->conn_->outputBytes() == 0; }
+        void await_suspend(std::coroutine_handle<> h){
+            conn_->writer_ = h;
+        }
+        bool await_resume() const { return !conn_->closed_; }
+
+    private:
+        Connection *conn_;
+    };
+
+    explicit Connection(const TcpConnectionPtr &conn)
+        : conn_(conn), readAwaiter_(nullptr), closed_(false)
+    {}
+
+    const TcpConnectionPtr &connection() const { return conn_; }
+    EventLoop *getLoop() const { return conn_->getloop(); }
+    bool connected() const { return !closed_; }
+
+    // 读取n个字节; read(0)立即返回空串
+    ReadAwaiter read(size_t n) { return ReadAwaiter(this, n, std::string()); }
+    // 读到delim为止,返回的数据包含delim
+    ReadAwaiter readUntil(const std::string &delim) { return ReadAwaiter(this, 0, delim); }
+
+    WriteAwaiter write(const std::string &data){
+        if(!closed_){
+            conn_->send(data);
+        }
+        return WriteAwaiter(this);
+    }
+    // 发送buf中的全部可读数据,发送后buf被清空
+    WriteAwaiter write(Buffer *buf){
+        if(!closed_){
+            conn_->send(buf);
+        }
+        return WriteAwaiter(this);
+    }
+
+    void shutdown() { conn_->shutdown(); }
+
+    // 为TcpServer/TcpClient设置连接、消息与写完成回调: 每个新连接启动一个handler协程
+    // 写完成回调只设置这一次,不随每次co_await切换,避免复制TcpServer连接共享的回调
+    template <typename Server>
+    static void serve(Server &server, const Handler &handler){
+        server.setConnectionCallback(std::bind(&Connection::onConnection, handler, std::placeholders::_1));
+        server.setMessageCallback(&Connection::onMessage);
+        server.setWriteCompleteCallback(&Connection::onWriteComplete);
+    }
+
+    static void onConnection(const Handler &handler, const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            ConnectionPtr c = std::make_shared<Connection>(conn);
+            conn->setContext(c);
+            handler(c);
+        }
+        else{
+            ConnectionPtr c = std::static_pointer_cast<Connection>(conn->getContext());
+            if(c){
+                // 断开Connection与TcpConnection的循环引用,之后由协程帧持有的ConnectionPtr决定其生命期
+                conn->setContext(std::shared_ptr<void>());
+                c->closed_ = true;
+                c->resumeReader();
+                c->resumeWriter();
+            }
+        }
+    }
+
+    static void onMessage(const TcpConnectionPtr &conn, Buffer *, Timestamp){
+        ConnectionPtr c = std::static_pointer_cast<Connection>(conn->getContext());
+        if(c && c->readAwaiter_ && c->readAwaiter_->satisfied()){
+            c->resumeReader();
+        }
+    }
+
+    static void onWriteComplete(const TcpConnectionPtr &conn){
+        ConnectionPtr c = std::static_pointer_cast<Connection>(conn->getContext());
+        // 没有协程在等待时直接返回; 直接写完时也会排队一次写完成回调,outputBuffer仍有数据时不能恢复等待者
+        if(c && c->writer_ && conn->outputBytes() == 0){
+            c->resumeWriter();
+        }
+    }
+
+private:
+    void resumeReader(){
+        if(reader_){
+            std::coroutine_handle<> h = reader_;
+            reader_ = nullptr;
+            readAwaiter_ = nullptr;
+            h.resume();
+        }
+    }
+    void resumeWriter(){
+        if(writer_){
+            std::coroutine_handle<> h = writer_;
+            writer_ = nullptr;
+            h.resume();
+        }
+    }
+
+    TcpConnectionPtr conn_;
+    std::coroutine_handle<> reader_;
+    std::coroutine_handle<> writer_;
+    ReadAwaiter *readAwaiter_; // 指向协程帧中的等待者
+    bool closed_;
+};
+
+// co_await coro::sleep(loop, ms): 在loop中等待ms毫秒后恢复
+class SleepAwaiter{
+public:
+    SleepAwaiter(EventLoop *loop, int64_t milliseconds) : loop_(loop), milliseconds_(milliseconds) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h){
+        loop_->runAfter(milliseconds_ / 1000.0, [h](){ h.resume(); });
+    }
+    void await_resume() const {}
+
+private:
+    EventLoop *loop_;
+    int64_t milliseconds_;
+};
+
+inline SleepAwaiter sleep(EventLoop *loop, int64_t milliseconds){
+    return SleepAwaiter(loop, milliseconds);
+}
+
+// co_await coro::post(loop): 切换到loop线程中继续执行;已在该loop中时相当于让出本轮
+class PostAwaiter{
+public:
+    explicit PostAwaiter(EventLoop *loop) : loop_(loop) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h){
+        loop_->queueInLoop([h](){ h.resume(); });
+    }
+    void await_resume() const {}
+
+private:
+    EventLoop *loop_;
+};
+
+inline PostAwaiter post(EventLoop *loop){
+    return PostAwaiter(loop);
+}
+
+} // namespace coro
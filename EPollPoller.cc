@@ -99,8 +99,8 @@ void EPollPoller::update(int operation, Channel *channel) {
 // activeChannels是传出参数,存储所有发生事件的channel集合
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
-    // 用LOG_DEBUG更合理
-    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, channels_.size());
+    // 低延迟模式下会以0超时频繁调用,只在调试时输出
+    LOG_DEBUG("func=%s => fd total count:%lu \n", __FUNCTION__, channels_.size());
 
     // events_.begin()返回首元素迭代器,先解引用得首元素，再取地址。即得到首元素的地址
     int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
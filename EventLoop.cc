@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <memory>
+#include <algorithm>
 
 // 防止一个线程创建多个EventLoop
 thread_local EventLoop *t_loopInThisThread = nullptr;
@@ -37,8 +38,16 @@ EventLoop::EventLoop()
     , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
     , poller_(Poller::newDefaultPoller(this))
+    , timerQueue_(new TimerQueue(this))
+    , busyPolling_(false)
+    , maxSpinUs_(0)
+    , spinBudgetUs_(0)
+    , spinHits_(0)
+    , spinMisses_(0)
     , wakeupFd_(createEventfd()) 
     , wakeupChannel_(new Channel(this,wakeupFd_)) 
+    , eventHandling_(false)
+    , bulkBudgetUs_(1000)
 {
     LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
     if(t_loopInThisThread){
@@ -77,16 +86,108 @@ void EventLoop::loop(){
     
     while(!quit_){
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        if(!bulkBacklog_.empty()){ // 还有没执行完的批量任务,只检查IO事件不阻塞
+            pollReturnTime_ = poller_->poll(0, &activeChannels_);
+        }
+        else{
+            pollReturnTime_ = busyPolling_ ? busyPoll() : poller_->poll(kPollTimeMs, &activeChannels_);
+        }
+        eventHandling_ = true;
         for(Channel *channel : activeChannels_){
             channel->handleEvent(pollReturnTime_);
         }
+        eventHandling_ = false;
+        doAfterEventsFunctors();
         doPendingFunctors();
+        doBulkFunctors();
     }
     LOG_INFO("EventLoop %p stop looping. \n", this);
     looping_ = false;
 }
 
+Timestamp EventLoop::cachedNow(){
+    if(t_loopInThisThread && t_loopInThisThread->looping_ && t_loopInThisThread->pollReturnTime_.valid()){
+        return t_loopInThisThread->pollReturnTime_;
+    }
+    return Timestamp::now();
+}
+
+EventLoop *EventLoop::currentLoop(){
+    return t_loopInThisThread;
+}
+
+size_t EventLoop::newLocalSlot(){
+    static std::atomic<size_t> nextSlot(0);
+    return nextSlot.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventLoop::setBusyPolling(bool on, int maxSpinUs){
+    busyPolling_ = on;
+    maxSpinUs_ = maxSpinUs > 0 ? maxSpinUs : 1;
+    spinBudgetUs_ = maxSpinUs_;
+}
+
+// 先在自旋预算内以0超时poll,落空后再阻塞; 根据自旋是否等到事件调整预算
+Timestamp EventLoop::busyPoll(){
+    Timestamp now = poller_->poll(0, &activeChannels_);
+    if(!activeChannels_.empty()){
+        return now;
+    }
+    const Timestamp deadline = addMicroSeconds(now, spinBudgetUs_);
+    while(!quit_ && now < deadline){
+        now = poller_->poll(0, &activeChannels_);
+        if(!activeChannels_.empty()){
+            ++spinHits_;
+            spinBudgetUs_ = std::min(spinBudgetUs_ * 2, maxSpinUs_);
+            return now;
+        }
+    }
+    ++spinMisses_;
+    const int minSpinUs = std::max(maxSpinUs_ / 16, 1);
+    spinBudgetUs_ = std::max(spinBudgetUs_ / 2, minSpinUs);
+
+    Timestamp blockStart = now;
+    now = poller_->poll(kPollTimeMs, &activeChannels_);
+    // 刚转入阻塞不久事件就到了,说明预算偏小
+    if(!activeChannels_.empty() && microSecondsDifference(now, blockStart) < maxSpinUs_){
+        spinBudgetUs_ = std::min(spinBudgetUs_ * 4, maxSpinUs_);
+    }
+    return now;
+}
+
+void EventLoop::doAfterEventsFunctors(){
+    if(afterEventsFunctors_.empty()){
+        return;
+    }
+    std::vector<Functor> functors;
+    functors.swap(afterEventsFunctors_);
+    for(const Functor &functor : functors){
+        functor();
+    }
+}
+
+// 在时间预算内按投递顺序执行批量任务,超出预算的留在bulkBacklog_中下一轮继续
+void EventLoop::doBulkFunctors(){
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for(Functor &functor : bulkFunctors_){
+            bulkBacklog_.push_back(std::move(functor));
+        }
+        bulkFunctors_.clear();
+    }
+    if(bulkBacklog_.empty()){
+        return;
+    }
+    callingPendingFunctors_ = true;
+    const Timestamp deadline = addMicroSeconds(Timestamp::now(), bulkBudgetUs_);
+    do{
+        Functor functor(std::move(bulkBacklog_.front()));
+        bulkBacklog_.pop_front();
+        functor();
+    }while(!bulkBacklog_.empty() && Timestamp::now() < deadline);
+    callingPendingFunctors_ = false;
+}
+
 void EventLoop::doPendingFunctors()
 {
     std::vector<Functor> functors;
@@ -136,6 +237,35 @@ void EventLoop::queueInLoop(Functor cb){
     }
 }
 
+void EventLoop::queueBulkInLoop(Functor cb){
+    bool wasEmpty = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wasEmpty = bulkFunctors_.empty();
+        bulkFunctors_.emplace_back(std::move(cb));
+    }
+    // 队列非空说明已经唤醒过、loop尚未取走,不必重复唤醒
+    if(wasEmpty && (!isInLoopThread() || callingPendingFunctors_)){
+        wakeup();
+    }
+}
+
+TimerId EventLoop::runAt(Timestamp time, Functor cb){
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, Functor cb){
+    return runAt(addTime(Timestamp::now(), delay), std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, Functor cb){
+    return timerQueue_->addTimer(std::move(cb), addTime(Timestamp::now(), interval), interval);
+}
+
+void EventLoop::cancel(TimerId timerId){
+    timerQueue_->cancel(timerId);
+}
+
 // 唤醒loop对应的线程 : 向wakeupfd_写一个数据,wakeupChannel发生读事件,当前loop线程会被唤醒
 // 当前loop在其他线程中执行wakeup(), 而当前loop对应的线程正阻塞
 // 那么写入的wakeupFd_就是当前loop的wakeupFd_,然后wakeupChannel发生读事件
@@ -5,10 +5,12 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <deque>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "TimerQueue.h"
 
 class Channel;
 class Poller;
@@ -27,11 +29,44 @@ public:
     void quit();
 
     Timestamp pollReturnTime() const { return pollReturnTime_; }
+    // 当前线程的loop本轮poll返回的时间,每轮刷新一次,回调中获取时间无需系统调用
+    // 不在loop线程中(或loop尚未poll)时退化为Timestamp::now()
+    static Timestamp cachedNow();
+
+    /**
+     * 低延迟模式: 一轮事件处理完后先以0超时反复poll(自旋),自旋预算内仍无事件才阻塞在epoll_wait上,
+     * 以CPU换取省去调度器唤醒的延迟. 预算在[maxSpinUs/16, maxSpinUs]内自适应:
+     * 自旋等到了事件(或刚转入阻塞就来了事件)则加倍,自旋落空则减半
+     * 需在loop线程中或loop开始前调用; socket上的SO_BUSY_POLL见TcpConnection::setBusyPoll
+     */
+    void setBusyPolling(bool on, int maxSpinUs = 50);
+    bool busyPolling() const { return busyPolling_; }
+    int spinBudgetUs() const { return spinBudgetUs_; }
+    // 自旋等到事件/落空的次数
+    int64_t spinHits() const { return spinHits_; }
+    int64_t spinMisses() const { return spinMisses_; }
 
     // 在当前loop中执行cb
     void runInLoop(Functor cb);
     // 把cb放入队列中，唤醒loop所在线程，执行cb
     void queueInLoop(Functor cb);
+    // 低优先级的批量任务: 在queueInLoop的任务之后执行,每轮最多执行bulkBudgetUs微秒,
+    // 剩下的留到下一轮(下一轮poll不阻塞),大量投递时不会拖慢IO事件与控制类任务
+    void queueBulkInLoop(Functor cb);
+    // 需在loop线程中或loop开始前调用,默认1000微秒
+    void setBulkBudgetUs(int budgetUs) { bulkBudgetUs_ = budgetUs; }
+    size_t bulkBacklog() const { return bulkBacklog_.size(); }
+
+    // 定时器,可在任意线程调用. 回调在loop线程中执行
+    TimerId runAt(Timestamp time, Functor cb);
+    TimerId runAfter(double delay, Functor cb); // delay单位为秒
+    TimerId runEvery(double interval, Functor cb);
+    void cancel(TimerId timerId);
+
+    // 本轮active channels处理完后、pendingFunctors之前执行cb,只能在loop线程中调用
+    void runAfterEvents(Functor cb) { afterEventsFunctors_.push_back(std::move(cb)); }
+    // 是否正在处理本轮的active channels
+    bool eventHandling() const { return eventHandling_; }
 
     // 唤醒loop所在的线程
     void wakeup();
@@ -43,10 +78,24 @@ public:
 
     // 判断EventLoop对象是否在自己的线程里
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
+    // 当前线程的loop,没有时返回nullptr
+    static EventLoop *currentLoop();
+
+    // 每个loop私有的存储槽,只能在loop线程中访问,因此无需加锁. 一般通过LoopLocal<T>使用
+    static size_t newLocalSlot(); // 分配一个新的槽号,所有loop共用同一套槽号
+    std::shared_ptr<void> &localSlot(size_t slot){
+        if(slot >= locals_.size()){
+            locals_.resize(slot + 1);
+        }
+        return locals_[slot];
+    }
 
 private:
     void handleRead(); 
     void doPendingFunctors();
+    void doAfterEventsFunctors();
+    void doBulkFunctors();
+    Timestamp busyPoll();
 
     using ChannelList = std::vector<Channel *>;
 
@@ -56,13 +105,26 @@ private:
     const pid_t threadId_; // 记录当前loop所在线程的id
     Timestamp pollReturnTime_; // poller返回发生事件的channels 的时间
     std::unique_ptr<Poller> poller_; // 当前loop管理的poller
+    std::unique_ptr<TimerQueue> timerQueue_;
+
+    bool busyPolling_;
+    int maxSpinUs_;
+    int spinBudgetUs_; // 当前自旋预算(微秒)
+    int64_t spinHits_;
+    int64_t spinMisses_;
 
     int wakeupFd_; // 当mainloop获取一个新的channel,通过轮询算法选择一个subloop,通过该成员唤醒subloop处理channel
     std::unique_ptr<Channel> wakeupChannel_; // 封装wakeupFd_为Channel
 
     ChannelList activeChannels_; // 临时存储一次事件循环中检测到的所有活跃Channel(作为poller->poll函数的传出参数)
+    bool eventHandling_;
+    std::vector<Functor> afterEventsFunctors_; // 只在loop线程中访问,无需加锁
 
     std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有需要执行的回调操作
     std::vector<Functor> pendingFunctors_; // 存储loop需要执行的所有回调操作
+    std::vector<Functor> bulkFunctors_; // queueBulkInLoop投递的任务,受mutex_保护
+    std::deque<Functor> bulkBacklog_;   // 已取出但本轮预算内没执行完的批量任务,只在loop线程中访问
+    int bulkBudgetUs_;
+    std::vector<std::shared_ptr<void>> locals_; // 按槽号索引,随loop一起析构
     std::mutex mutex_; // 保护pendingFunctors_线程安全
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "FixedSizePool.h"
+
+#include <new>
+#include <algorithm>
+#include <cstddef>
+
+FixedSizePool::~FixedSizePool(){
+    for(char *chunk : chunks_){
+        ::operator delete(chunk);
+    }
+}
+
+void *FixedSizePool::allocate(size_t size){
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(blockSize_ == 0){
+            // 块要能放下空闲链表指针,并保持指针对齐
+            blockSize_ = (std::max(size, sizeof(FreeBlock)) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        }
+        if(size <= blockSize_){
+            if(!freeList_){
+                char *chunk = static_cast<char *>(::operator new(blockSize_ * kBlocksPerChunk));
+                chunks_.push_back(chunk);
+                allocated_ += kBlocksPerChunk;
+                for(size_t i = kBlocksPerChunk; i > 0; --i){
+                    FreeBlock *block = reinterpret_cast<FreeBlock *>(chunk + (i - 1) * blockSize_);
+                    block->next = freeList_;
+                    freeList_ = block;
+                }
+            }
+            FreeBlock *block = freeList_;
+            freeList_ = block->next;
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void FixedSizePool::deallocate(void *p, size_t size){
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(size <= blockSize_){
+        FreeBlock *block = static_cast<FreeBlock *>(p);
+        block->next = freeList_;
+        freeList_ = block;
+        return;
+    }
+    lock.unlock();
+    ::operator delete(p);
+}
+
+size_t FixedSizePool::capacity() const{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return allocated_;
+}
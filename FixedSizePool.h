@@ -0,0 +1,67 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+
+/**
+ * 定长内存块池: 一次向系统申请kBlocksPerChunk块,释放的块挂在空闲链表上复用
+ * 块大小在第一次分配时确定,之后大小不同的请求直接走operator new
+ * 释放可能发生在任意线程(最后一个TcpConnectionPtr在哪个线程析构),所以用锁保护
+ */
+class FixedSizePool : noncopyable{
+public:
+    static const size_t kBlocksPerChunk = 64;
+
+    FixedSizePool() : blockSize_(0), freeList_(nullptr), allocated_(0) {}
+    ~FixedSizePool();
+
+    void *allocate(size_t size);
+    void deallocate(void *p, size_t size);
+
+    size_t blockSize() const { return blockSize_; }
+    // 已向系统申请的块数
+    size_t capacity() const;
+
+private:
+    struct FreeBlock{
+        FreeBlock *next;
+    };
+
+    mutable std::mutex mutex_;
+    size_t blockSize_;
+    FreeBlock *freeList_;
+    std::vector<char *> chunks_;
+    size_t allocated_;
+};
+
+// 供std::allocate_shared使用的分配器,连同控制块一起从FixedSizePool分配
+template <typename T>
+class PoolAllocator{
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(const std::shared_ptr<FixedSizePool> &pool) : pool_(pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool()) {}
+
+    T *allocate(size_t n){
+        return static_cast<T *>(pool_->allocate(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n){
+        pool_->deallocate(p, n * sizeof(T));
+    }
+
+    const std::shared_ptr<FixedSizePool> &pool() const { return pool_; }
+
+private:
+    std::shared_ptr<FixedSizePool> pool_; // 保证对象释放前池仍然存在
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.pool() == b.pool(); }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.pool() != b.pool(); }
@@ -0,0 +1,113 @@
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <math.h>
+
+HdrHistogram::HdrHistogram()
+    : counts_(new std::atomic<int64_t>[kCounters])
+    , count_(0)
+    , sum_(0)
+    , max_(0)
+{
+    reset();
+}
+
+HdrHistogram::HdrHistogram(const HdrHistogram &other)
+    : HdrHistogram()
+{
+    merge(other);
+}
+
+HdrHistogram &HdrHistogram::operator=(const HdrHistogram &other){
+    if(this != &other){
+        reset();
+        merge(other);
+    }
+    return *this;
+}
+
+/**
+ * 小于128的值直接作为下标; 其余的值按最高位所在的2的幂区间分组,
+ * 每组取最高的7位(64~127)区分,组内64个计数器
+ */
+int HdrHistogram::indexOf(int64_t value){
+    const int kSubBuckets = 1 << kSubBucketBits;
+    const int kHalf = kSubBuckets / 2;
+    if(value < kSubBuckets){
+        return static_cast<int>(value < 0 ? 0 : value);
+    }
+    value = std::min(value, (static_cast<int64_t>(1) << kMaxValueBits) - 1);
+    int msb = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    int shift = msb - (kSubBucketBits - 1);
+    int top = static_cast<int>(value >> shift); // [64, 128)
+    return kSubBuckets + (shift - 1) * kHalf + (top - kHalf);
+}
+
+int64_t HdrHistogram::highestEquivalentValue(int index){
+    const int kSubBuckets = 1 << kSubBucketBits;
+    const int kHalf = kSubBuckets / 2;
+    if(index < kSubBuckets){
+        return index;
+    }
+    int shift = (index - kSubBuckets) / kHalf + 1;
+    int64_t top = (index - kSubBuckets) % kHalf + kHalf;
+    return ((top + 1) << shift) - 1;
+}
+
+void HdrHistogram::record(int64_t value){
+    if(value < 0){
+        value = 0;
+    }
+    add(counts_[indexOf(value)], 1);
+    add(count_, 1);
+    add(sum_, value);
+    if(value > max_.load(std::memory_order_relaxed)){
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void HdrHistogram::merge(const HdrHistogram &other){
+    for(int i = 0; i < kCounters; ++i){
+        int64_t n = other.counts_[i].load(std::memory_order_relaxed);
+        if(n != 0){
+            add(counts_[i], n);
+        }
+    }
+    add(count_, other.count_.load(std::memory_order_relaxed));
+    add(sum_, other.sum_.load(std::memory_order_relaxed));
+    max_.store(std::max(max(), other.max()), std::memory_order_relaxed);
+}
+
+void HdrHistogram::reset(){
+    for(int i = 0; i < kCounters; ++i){
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+double HdrHistogram::mean() const{
+    int64_t n = count();
+    return n == 0 ? 0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / n;
+}
+
+int64_t HdrHistogram::valueAtPercentile(double percentile) const{
+    int64_t total = 0;
+    for(int i = 0; i < kCounters; ++i){
+        total += counts_[i].load(std::memory_order_relaxed);
+    }
+    if(total == 0){
+        return 0;
+    }
+    int64_t target = static_cast<int64_t>(ceil(std::min(percentile, 100.0) / 100.0 * total));
+    target = std::max<int64_t>(target, 1);
+    int64_t seen = 0;
+    for(int i = 0; i < kCounters; ++i){
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if(seen >= target){
+            return std::min(highestEquivalentValue(i), max());
+        }
+    }
+    return max();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+/**
+ * 高动态范围直方图(HDR): 每个2的幂区间再等分64份,相对误差不超过1/64,
+ * 记录值范围[0, 2^40),足以覆盖以微秒计的延迟. 计数器个数固定,record不分配内存
+ * 单写者: 只有一个线程record,不需要原子读改写; 其他线程可以随时merge/读取一个近似一致的快照
+ */
+class HdrHistogram{
+public:
+    HdrHistogram();
+    HdrHistogram(const HdrHistogram &other);
+    HdrHistogram &operator=(const HdrHistogram &other);
+
+    void record(int64_t value);
+    // 把other的计数累加进来,用于合并各线程的直方图
+    void merge(const HdrHistogram &other);
+    void reset();
+
+    int64_t count() const { return count_.load(std::memory_order_relaxed); }
+    int64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    // 第percentile百分位所在区间的上界, percentile取[0, 100]
+    int64_t valueAtPercentile(double percentile) const;
+
+    static const int kSubBucketBits = 7;
+    static const int kMaxValueBits = 40;
+    static const int kCounters = (1 << kSubBucketBits) + (kMaxValueBits - kSubBucketBits) * (1 << (kSubBucketBits - 1));
+
+private:
+    static int indexOf(int64_t value);
+    static int64_t highestEquivalentValue(int index);
+
+    // 单写者的自增: 普通的读加写,只是用原子类型避免与读者之间的数据竞争
+    static void add(std::atomic<int64_t> &counter, int64_t n){
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<std::atomic<int64_t>[]> counts_;
+    std::atomic<int64_t> count_;
+    std::atomic<int64_t> sum_;
+    std::atomic<int64_t> max_;
+};
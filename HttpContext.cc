@@ -0,0 +1,137 @@
+#include "HttpContext.h"
+#include "Buffer.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// 请求行: METHOD SP path[?query] SP HTTP/1.x
+bool HttpContext::processRequestLine(const char *begin, const char *end){
+    const char *space = std::find(begin, end, ' ');
+    if(space == end || !request_.setMethod(begin, space)){
+        return false;
+    }
+    const char *start = space + 1;
+    space = std::find(start, end, ' ');
+    if(space == end){
+        return false;
+    }
+    const char *question = std::find(start, space, '?');
+    if(question != space){
+        request_.setPath(start, question);
+        request_.setQuery(question + 1, space);
+    }
+    else{
+        request_.setPath(start, space);
+    }
+
+    start = space + 1;
+    if(end - start != 8 || !std::equal(start, end - 1, "HTTP/1.")){
+        return false;
+    }
+    if(end[-1] == '1'){
+        request_.setVersion(HttpRequest::kHttp11);
+    }
+    else if(end[-1] == '0'){
+        request_.setVersion(HttpRequest::kHttp10);
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+// header行: field: value; 空行表示headers结束
+bool HttpContext::processHeaderLine(const char *begin, const char *end){
+    if(begin == end){
+        if(!request_.getHeader("Transfer-Encoding").empty()){
+            return false; // 不支持chunked请求体
+        }
+        std::string contentLength = request_.getHeader("Content-Length");
+        if(contentLength.empty()){
+            state_ = kGotAll;
+            return true;
+        }
+        // 只接受数字: strtoull还会接受前导空白与正负号
+        if(contentLength.find_first_not_of("0123456789") != std::string::npos){
+            return false;
+        }
+        unsigned long long length = strtoull(contentLength.c_str(), nullptr, 10);
+        if(length > kMaxBodyLength){
+            return false;
+        }
+        bodyLength_ = length;
+        state_ = bodyLength_ > 0 ? kExpectBody : kGotAll;
+        return true;
+    }
+    const char *colon = std::find(begin, end, ':');
+    if(colon == end || colon == begin || ++headerCount_ > kMaxHeaders){
+        return false;
+    }
+    // 重复的Content-Length取值不同时拒绝(RFC 9112 6.3): 前后端各取一个值是请求走私的常见手段
+    static const char kContentLength[] = "content-length";
+    bool isContentLength = static_cast<size_t>(colon - begin) == sizeof(kContentLength) - 1
+                           && ::strncasecmp(begin, kContentLength, sizeof(kContentLength) - 1) == 0;
+    bool repeated = isContentLength && request_.headers().count(kContentLength) > 0;
+    std::string previous = repeated ? request_.getHeader(kContentLength) : std::string();
+    request_.addHeader(begin, colon, end);
+    if(isContentLength){
+        std::string value = request_.getHeader(kContentLength);
+        if(value.empty() || (repeated && value != previous)){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime){
+    while(state_ != kGotAll){
+        if(state_ == kExpectBody){
+            if(buf->readableBytes() < bodyLength_){
+                break;
+            }
+            request_.body().assign(buf->peek(), bodyLength_);
+            buf->retrieve(bodyLength_);
+            state_ = kGotAll;
+            break;
+        }
+
+        // 从上次扫描结束的位置继续查找CRLF; 退回一个字节,以防'\r'恰好是上次数据的最后一个字节
+        const char *begin = buf->peek();
+        const char *end = buf->beginWrite();
+        const char *from = begin + (scanned_ > 0 ? scanned_ - 1 : 0);
+        const char *cr = static_cast<const char *>(::memchr(from, '\r', end - from));
+        while(cr != nullptr && cr + 1 < end && cr[1] != '\n'){
+            cr = static_cast<const char *>(::memchr(cr + 1, '\r', end - cr - 1));
+        }
+        if(cr == nullptr || cr + 1 >= end){ // 这一行还没收全
+            scanned_ = end - begin;
+            if(scanned_ > kMaxLineLength){
+                return false;
+            }
+            break;
+        }
+        scanned_ = 0;
+        if(static_cast<size_t>(cr - begin) > kMaxLineLength){ // 一次就收全的超长行
+            return false;
+        }
+
+        bool ok = false;
+        if(state_ == kExpectRequestLine){
+            ok = processRequestLine(begin, cr);
+            if(ok){
+                request_.setReceiveTime(receiveTime);
+                state_ = kExpectHeaders;
+            }
+        }
+        else{
+            ok = processHeaderLine(begin, cr);
+        }
+        buf->retrieve(cr + 2 - begin);
+        if(!ok){
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "HttpRequest.h"
+#include "Timestamp.h"
+
+#include <stddef.h>
+
+class Buffer;
+
+/**
+ * 每个连接一个的增量HTTP请求解析器
+ * 直接在inputBuffer_上解析,每解析完一行就retrieve掉;
+ * 一行没收全时记录已扫描过的长度,下次收到数据后从该位置继续查找CRLF,不会重复扫描
+ */
+class HttpContext{
+public:
+    enum HttpRequestParseState{
+        kExpectRequestLine,
+        kExpectHeaders,
+        kExpectBody,
+        kGotAll,
+    };
+
+    static const size_t kMaxLineLength = 8 * 1024;      // 请求行/单个header的最大长度
+    static const size_t kMaxHeaders = 100;
+    static const size_t kMaxBodyLength = 8 * 1024 * 1024;
+
+    HttpContext()
+        : state_(kExpectRequestLine)
+        , scanned_(0)
+        , headerCount_(0)
+        , bodyLength_(0)
+    {}
+
+    // 返回false表示请求格式错误; 解析出一个完整请求后gotAll()为true,处理完需reset()
+    bool parseRequest(Buffer *buf, Timestamp receiveTime);
+
+    bool gotAll() const { return state_ == kGotAll; }
+
+    void reset(){
+        state_ = kExpectRequestLine;
+        scanned_ = 0;
+        headerCount_ = 0;
+        bodyLength_ = 0;
+        HttpRequest dummy;
+        request_.swap(dummy);
+    }
+
+    const HttpRequest &request() const { return request_; }
+    HttpRequest &request() { return request_; }
+
+private:
+    bool processRequestLine(const char *begin, const char *end);
+    bool processHeaderLine(const char *begin, const char *end);
+
+    HttpRequestParseState state_;
+    HttpRequest request_;
+    size_t scanned_;     // 当前行已经扫描过且不含CRLF的字节数
+    size_t headerCount_;
+    size_t bodyLength_;  // Content-Length
+};
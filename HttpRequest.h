@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Timestamp.h"
+
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <ctype.h>
+
+// 一个解析完成的HTTP请求
+class HttpRequest{
+public:
+    enum Method{ kInvalid, kGet, kPost, kHead, kPut, kDelete };
+    enum Version{ kUnknown, kHttp10, kHttp11 };
+
+    HttpRequest() : method_(kInvalid), version_(kUnknown) {}
+
+    bool setMethod(const char *start, const char *end){
+        std::string m(start, end);
+        if(m == "GET"){
+            method_ = kGet;
+        }
+        else if(m == "POST"){
+            method_ = kPost;
+        }
+        else if(m == "HEAD"){
+            method_ = kHead;
+        }
+        else if(m == "PUT"){
+            method_ = kPut;
+        }
+        else if(m == "DELETE"){
+            method_ = kDelete;
+        }
+        else{
+            method_ = kInvalid;
+        }
+        return method_ != kInvalid;
+    }
+    Method method() const { return method_; }
+
+    void setVersion(Version v) { version_ = v; }
+    Version version() const { return version_; }
+
+    void setPath(const char *start, const char *end) { path_.assign(start, end); }
+    const std::string &path() const { return path_; }
+
+    void setQuery(const char *start, const char *end) { query_.assign(start, end); }
+    const std::string &query() const { return query_; }
+
+    void setReceiveTime(Timestamp t) { receiveTime_ = t; }
+    Timestamp receiveTime() const { return receiveTime_; }
+
+    // field: value, value两端的空白被去掉. field不区分大小写,统一转为小写保存
+    void addHeader(const char *start, const char *colon, const char *end){
+        std::string field(start, colon);
+        std::transform(field.begin(), field.end(), field.begin(), ::tolower);
+        ++colon;
+        while(colon < end && (*colon == ' ' || *colon == '\t')){
+            ++colon;
+        }
+        while(end > colon && (end[-1] == ' ' || end[-1] == '\t')){
+            --end;
+        }
+        headers_[field] = std::string(colon, end);
+    }
+
+    // 查找header,没有时返回空串
+    std::string getHeader(std::string field) const{
+        std::transform(field.begin(), field.end(), field.begin(), ::tolower);
+        auto it = headers_.find(field);
+        return it != headers_.end() ? it->second : std::string();
+    }
+    const std::unordered_map<std::string, std::string> &headers() const { return headers_; }
+
+    std::string &body() { return body_; }
+    const std::string &body() const { return body_; }
+
+    void swap(HttpRequest &that){
+        std::swap(method_, that.method_);
+        std::swap(version_, that.version_);
+        path_.swap(that.path_);
+        query_.swap(that.query_);
+        std::swap(receiveTime_, that.receiveTime_);
+        headers_.swap(that.headers_);
+        body_.swap(that.body_);
+    }
+
+private:
+    Method method_;
+    Version version_;
+    std::string path_;
+    std::string query_;
+    Timestamp receiveTime_;
+    std::unordered_map<std::string, std::string> headers_;
+    std::string body_;
+};
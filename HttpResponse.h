@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+class Buffer;
+
+// HTTP响应,由appendToBuffer直接序列化到发送缓冲区
+class HttpResponse{
+public:
+    enum HttpStatusCode{
+        kUnknown,
+        k200Ok = 200,
+        k301MovedPermanently = 301,
+        k400BadRequest = 400,
+        k404NotFound = 404,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+    };
+
+    explicit HttpResponse(bool close)
+        : statusCode_(kUnknown)
+        , closeConnection_(close)
+    {}
+
+    void setStatusCode(HttpStatusCode code) { statusCode_ = code; }
+    void setStatusMessage(const std::string &message) { statusMessage_ = message; }
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const std::string &contentType) { addHeader("Content-Type", contentType); }
+    void addHeader(const std::string &key, const std::string &value) { headers_[key] = value; }
+
+    void setBody(const std::string &body) { body_ = body; }
+
+    // 状态行 + headers + body 写入output. HEAD请求的响应withBody为false: Content-Length照常给出,不带body
+    void appendToBuffer(Buffer *output, bool withBody = true) const;
+
+private:
+    HttpStatusCode statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_; // 发送完该响应后是否关闭连接
+    std::unordered_map<std::string, std::string> headers_;
+    std::string body_;
+};
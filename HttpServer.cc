@@ -0,0 +1,81 @@
+#include "HttpServer.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "logger.h"
+
+#include <memory>
+#include <strings.h>
+
+// 默认的请求处理: 全部返回404
+static void defaultHttpCallback(const HttpRequest &, HttpResponse *resp){
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
+    resp->setCloseConnection(true);
+}
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const std::string &name,
+                       TcpServer::Option option)
+    : server_(loop, listenAddr, name, option)
+    , httpCallback_(defaultHttpCallback)
+{
+    server_.setConnectionCallback(std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&HttpServer::onMessage, this,
+                                         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void HttpServer::start(){
+    LOG_INFO("HttpServer[%s] starts listening \n", server_.name().c_str());
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn){
+    if(conn->connected()){
+        conn->setContext(std::make_shared<HttpContext>());
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime){
+    if(!conn->connected()){ // 已决定关闭连接,丢弃之后收到的请求
+        buf->retrieveAll();
+        return;
+    }
+    HttpContext *context = static_cast<HttpContext *>(conn->getContext().get());
+
+    Buffer output;
+    bool close = false;
+    while(!close){
+        if(!context->parseRequest(buf, receiveTime)){
+            static const char kBadRequest[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            output.append(kBadRequest, sizeof(kBadRequest) - 1);
+            close = true;
+            break;
+        }
+        if(!context->gotAll()){ // 剩余数据不足一个完整请求,等待下次可读
+            break;
+        }
+        close = onRequest(context->request(), &output);
+        context->reset();
+    }
+
+    if(output.readableBytes() > 0){
+        conn->send(&output);
+    }
+    if(close){
+        buf->retrieveAll();
+        conn->shutdown();
+    }
+}
+
+bool HttpServer::onRequest(const HttpRequest &req, Buffer *output){
+    // header的值不区分大小写
+    const std::string connection = req.getHeader("Connection");
+    bool close = ::strcasecmp(connection.c_str(), "close") == 0 ||
+                 (req.version() == HttpRequest::kHttp10 && ::strcasecmp(connection.c_str(), "keep-alive") != 0);
+    HttpResponse response(close);
+    httpCallback_(req, &response);
+    response.appendToBuffer(output, req.method() != HttpRequest::kHead);
+    return response.closeConnection();
+}
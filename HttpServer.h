@@ -0,0 +1,40 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+
+#include <functional>
+#include <string>
+
+class HttpRequest;
+class HttpResponse;
+
+/**
+ * 基于TcpServer的HTTP/1.1服务器
+ * 支持keep-alive与pipelining: 一次onMessage中解析出的多个请求依次调用httpCallback_,
+ * 响应按请求顺序序列化到同一个Buffer中,最后一次send发出
+ */
+class HttpServer : noncopyable {
+public:
+    using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+
+    HttpServer(EventLoop *loop,
+               const InetAddress &listenAddr,
+               const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+    void start();
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // 处理一个请求,响应写入output. 返回true表示之后需要关闭连接
+    bool onRequest(const HttpRequest &req, Buffer *output);
+
+    TcpServer server_;
+    HttpCallback httpCallback_;
+};
@@ -1,22 +1,66 @@
 #include "InetAddress.h"
+#include "logger.h"
 
 #include <string.h>
+#include <stddef.h>
 #include <iostream>
+#include <algorithm>
 
 InetAddress::InetAddress(uint16_t port, std::string ip){
-    bzero(&addr_, sizeof(addr_));
+    bzero(&addrun_, sizeof(addrun_));
+    addrlen_ = sizeof(sockaddr_in);
     addr_.sin_family = AF_INET;
     addr_.sin_port = htons(port);
     addr_.sin_addr.s_addr = inet_addr(ip.c_str());
 }
+InetAddress InetAddress::unixAddress(const std::string &path, bool abstractNamespace){
+    sockaddr_un addr;
+    bzero(&addr, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // 抽象命名空间: sun_path[0]为'\0',名字不以'\0'结尾,长度由addrlen决定
+    // 文件路径需留出结尾的'\0',抽象命名空间需留出开头的'\0'. 放不下时不能截断: 截断后是另一个名字
+    size_t offset = abstractNamespace ? 1 : 0;
+    size_t len = path.size();
+    if(len > sizeof(addr.sun_path) - 1){
+        LOG_FATAL("%s:%s:%d unix socket path too long (%zu bytes): %s \n", __FILE__, __FUNCTION__, __LINE__,
+                  len, path.c_str());
+    }
+    ::memcpy(addr.sun_path + offset, path.data(), len);
+    socklen_t addrlen = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + offset + len + (abstractNamespace ? 0 : 1));
+    return InetAddress(reinterpret_cast<const sockaddr *>(&addr), addrlen);
+}
+
+void InetAddress::setSockAddr(const sockaddr *addr, socklen_t addrlen){
+    bzero(&addrun_, sizeof(addrun_));
+    addrlen_ = std::min(addrlen, static_cast<socklen_t>(sizeof(addrun_)));
+    ::memcpy(&addrun_, addr, addrlen_);
+}
+
+std::string InetAddress::unixPath() const{
+    size_t offset = offsetof(sockaddr_un, sun_path);
+    if(!isUnix() || addrlen_ <= offset){ // 未绑定的Unix域socket(如客户端)没有路径
+        return std::string();
+    }
+    if(addrun_.sun_path[0] == '\0'){
+        return "@" + std::string(addrun_.sun_path + 1, addrlen_ - offset - 1);
+    }
+    return std::string(addrun_.sun_path);
+}
+
 // 取 addr_中的ip(要转成主机字节序)
 std::string InetAddress::toIp() const{
+    if(isUnix()){
+        return unixPath();
+    }
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
     return buf;
 }
 // 取 addr_中的ip+port(要转成主机字节序)
 std::string InetAddress::toIpPort() const{
+    if(isUnix()){
+        return "unix:" + unixPath();
+    }
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
     size_t end = strlen(buf);
@@ -26,6 +70,9 @@ std::string InetAddress::toIpPort() const{
 }
 // 取 addr_中的port(要转成主机字节序)
 uint16_t InetAddress::toPort() const{
+    if(isUnix()){
+        return 0;
+    }
     return ntohs(addr_.sin_port);
 }
 
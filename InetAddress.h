@@ -1,23 +1,44 @@
 #pragma once
 
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <string>
 
-// 封装socket地址类型
+// 封装socket地址类型: IPv4(sockaddr_in) 或 Unix域(sockaddr_un)
 class InetAddress{
 public:
     explicit InetAddress(uint16_t port = 0, std::string ip = "127.0.0.1");
 
     explicit InetAddress(const sockaddr_in& addr)
-        :addr_(addr){}
+        :addr_(addr), addrlen_(sizeof(sockaddr_in)){}
+
+    // accept/getsockname等返回的任意地址
+    InetAddress(const sockaddr *addr, socklen_t addrlen) { setSockAddr(addr, addrlen); }
+
+    // Unix域socket地址; abstractNamespace为true时使用Linux抽象命名空间,不在文件系统中创建文件
+    // path超过sun_path能容纳的长度(107字节)时LOG_FATAL
+    static InetAddress unixAddress(const std::string &path, bool abstractNamespace = false);
+
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isUnix() const { return family() == AF_UNIX; }
+    // Unix域地址的路径(抽象命名空间的路径以'@'开头表示)
+    std::string unixPath() const;
 
     std::string toIp() const;
     std::string toIpPort() const;
     uint16_t toPort() const;
 
-    const sockaddr_in *getSockAddr() const { return &addr_; }
-    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; }
+    const sockaddr *getSockAddr() const { return reinterpret_cast<const sockaddr *>(&addr_); }
+    socklen_t getSockLen() const { return addrlen_; }
+    const sockaddr_in *getSockAddrInet() const { return &addr_; }
+    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; addrlen_ = sizeof(addr); }
+    void setSockAddr(const sockaddr *addr, socklen_t addrlen);
 
 private:
-    sockaddr_in addr_;
-};
\ No newline at end of file
+    union{
+        sockaddr_in addr_;
+        sockaddr_un addrun_;
+    };
+    socklen_t addrlen_; // 地址的实际长度,抽象命名空间的Unix域地址依赖它
+};
@@ -0,0 +1,42 @@
+#include "LengthHeaderCodec.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+#include "logger.h"
+
+#include <endian.h>
+#include <sys/uio.h>
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime){
+    // inputBuffer_中可能有多个完整消息,也可能只有半个
+    while(buf->readableBytes() >= kHeaderLen){
+        const int32_t len = buf->peekInt32();
+        if(len < 0 || static_cast<size_t>(len) > maxFrameSize_){
+            LOG_ERROR("LengthHeaderCodec::onMessage [%s] invalid frame length %d \n", conn->name().c_str(), len);
+            buf->retrieveAll();
+            conn->forceClose();
+            break;
+        }
+        if(buf->readableBytes() < kHeaderLen + len){ // 消息体还没收全
+            break;
+        }
+        buf->retrieveInt32();
+        frameCallback_(conn, buf->peek(), len, receiveTime);
+        buf->retrieve(len);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *buf){
+    buf->prependInt32(static_cast<int32_t>(buf->readableBytes()));
+    conn->send(buf);
+}
+
+// 头部与data用writev一起发送,data不经过中间缓冲区
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const char *data, size_t len){
+    int32_t be32 = htobe32(static_cast<int32_t>(len));
+    struct iovec iov[2];
+    iov[0].iov_base = &be32;
+    iov[0].iov_len = kHeaderLen;
+    iov[1].iov_base = const_cast<char *>(data);
+    iov[1].iov_len = len;
+    conn->send(iov, 2);
+}
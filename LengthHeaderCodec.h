@@ -0,0 +1,45 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Timestamp.h"
+
+#include <functional>
+#include <string>
+#include <stdint.h>
+
+class Buffer;
+
+/**
+ * 长度头编解码器: 每个消息前有一个4字节(网络字节序)的长度头
+ * TcpConnection的MessageCallback => LengthHeaderCodec::onMessage => 对每个完整消息调用FrameCallback
+ * 消息内容直接指向inputBuffer_内部,不做拷贝; 发送时把长度头写入Buffer的prependable区域
+ */
+class LengthHeaderCodec : noncopyable {
+public:
+    // [data, data+len) 指向inputBuffer_中的一个完整消息,仅在回调期间有效
+    using FrameCallback = std::function<void(const TcpConnectionPtr &, const char *data, size_t len, Timestamp)>;
+
+    static const size_t kHeaderLen = sizeof(int32_t);
+    static const size_t kDefaultMaxFrameSize = 64 * 1024 * 1024;
+
+    explicit LengthHeaderCodec(const FrameCallback &cb, size_t maxFrameSize = kDefaultMaxFrameSize)
+        : frameCallback_(cb)
+        , maxFrameSize_(maxFrameSize)
+    {}
+
+    // 设置为TcpServer/TcpConnection的MessageCallback
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    // 发送buf中的全部可读数据作为一个消息,长度头写入buf的prependable区域,不拷贝消息体
+    void send(const TcpConnectionPtr &conn, Buffer *buf);
+    void send(const TcpConnectionPtr &conn, const char *data, size_t len);
+    void send(const TcpConnectionPtr &conn, const std::string &message)
+    { send(conn, message.data(), message.size()); }
+
+    size_t maxFrameSize() const { return maxFrameSize_; }
+
+private:
+    FrameCallback frameCallback_;
+    const size_t maxFrameSize_; // 超过该长度的消息视为非法,关闭连接
+};
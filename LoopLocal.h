@@ -0,0 +1,188 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * 每个loop各有一份的T(按loop分片的状态: 统计计数、配置快照、本地缓存)
+ * 值存放在EventLoop的存储槽中,第一次在某个loop上访问时由factory创建,随loop一起析构
+ * get()只能在loop线程中调用,因此读写都不需要加锁; 其他线程通过invokeOnAll访问各个loop上的值
+ * 槽号不回收,LoopLocal应当与服务同寿命(作为静态变量或服务对象的成员)
+ */
+template <typename T>
+class LoopLocal : noncopyable{
+public:
+    using Factory = std::function<std::shared_ptr<T>()>;
+
+    LoopLocal()
+        : slot_(EventLoop::newLocalSlot())
+        , factory_([](){ return std::make_shared<T>(); })
+    {
+    }
+
+    explicit LoopLocal(Factory factory)
+        : slot_(EventLoop::newLocalSlot())
+        , factory_(std::move(factory))
+    {
+    }
+
+    // 当前线程的loop上的值
+    T &get(){
+        EventLoop *loop = EventLoop::currentLoop();
+        if(loop == nullptr){
+            LOG_FATAL("%s:%s:%d LoopLocal accessed outside of a loop thread \n", __FILE__, __FUNCTION__, __LINE__);
+        }
+        return get(loop);
+    }
+
+    // loop上的值,需在loop线程中调用
+    T &get(EventLoop *loop){
+        std::shared_ptr<void> &value = loop->localSlot(slot_);
+        if(!value){
+            value = factory_();
+        }
+        return *static_cast<T *>(value.get());
+    }
+
+    T &operator*() { return get(); }
+    T *operator->() { return &get(); }
+
+private:
+    const size_t slot_;
+    Factory factory_;
+};
+
+namespace detail{
+
+// invokeOnAll的汇总状态: 每个loop写自己的下标,最后一个完成的loop交付结果
+// 结果先存在数组中: vector<bool>按位存储,不同线程写相邻的元素会互相覆盖
+template <typename R>
+struct InvokeGather{
+    explicit InvokeGather(size_t n) : results(new R[n]), size(n), remaining(n) {}
+
+    template <typename F>
+    void run(size_t index, EventLoop *loop, F &fn){
+        try{
+            results[index] = fn(loop);
+        }
+        catch(...){
+            setError(std::current_exception());
+        }
+        finish();
+    }
+
+    void setError(std::exception_ptr e){
+        std::unique_lock<std::mutex> lock(mutex);
+        if(!error){
+            error = e;
+        }
+    }
+
+    void finish(){
+        if(remaining.fetch_sub(1, std::memory_order_acq_rel) != 1){
+            return;
+        }
+        if(error){
+            promise.set_exception(error);
+        }
+        else{
+            promise.set_value(std::vector<R>(std::make_move_iterator(results.get()),
+                                             std::make_move_iterator(results.get() + size)));
+        }
+    }
+
+    std::unique_ptr<R[]> results;
+    const size_t size;
+    std::atomic<size_t> remaining;
+    std::mutex mutex; // 只保护error
+    std::exception_ptr error;
+    std::promise<std::vector<R>> promise;
+};
+
+template <>
+struct InvokeGather<void>{
+    explicit InvokeGather(size_t n) : remaining(n) {}
+
+    template <typename F>
+    void run(size_t, EventLoop *loop, F &fn){
+        try{
+            fn(loop);
+        }
+        catch(...){
+            setError(std::current_exception());
+        }
+        finish();
+    }
+
+    void setError(std::exception_ptr e){
+        std::unique_lock<std::mutex> lock(mutex);
+        if(!error){
+            error = e;
+        }
+    }
+
+    void finish(){
+        if(remaining.fetch_sub(1, std::memory_order_acq_rel) != 1){
+            return;
+        }
+        if(error){
+            promise.set_exception(error);
+        }
+        else{
+            promise.set_value();
+        }
+    }
+
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::exception_ptr error;
+    std::promise<void> promise;
+};
+
+template <typename R>
+struct InvokeResult{
+    using type = std::vector<R>;
+};
+
+template <>
+struct InvokeResult<void>{
+    using type = void;
+};
+
+} // namespace detail
+
+/**
+ * 在每个loop的线程中各执行一次fn(EventLoop *),各个loop并行执行,互不等待
+ * 返回的future在全部执行完后就绪: 结果按loops的顺序排列(fn返回void时为future<void>),
+ * fn抛出的第一个异常由future重新抛出. 可在任意线程调用,但不要在某个loop线程中等待这个future
+ * R需可默认构造
+ */
+template <typename F, typename R = decltype(std::declval<F &>()(std::declval<EventLoop *>()))>
+std::future<typename detail::InvokeResult<R>::type> invokeOnAll(const std::vector<EventLoop *> &loops, F fn){
+    auto gather = std::make_shared<detail::InvokeGather<R>>(loops.size());
+    auto future = gather->promise.get_future();
+    if(loops.empty()){
+        gather->remaining = 1;
+        gather->finish(); // 没有loop时立即就绪
+        return future;
+    }
+    // fn由所有loop共享,只拷贝一次
+    auto shared = std::make_shared<F>(std::move(fn));
+    for(size_t i = 0; i < loops.size(); ++i){
+        EventLoop *loop = loops[i];
+        loop->runInLoop([gather, shared, i, loop](){ gather->run(i, loop, *shared); });
+    }
+    return future;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "EventLoop.h"
+#include "SpscRing.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * 一组loop之间直接传递T类型消息的通道(按loop分片的服务把请求转发给另一个分片)
+ * 每个有序的(from, to)对各有一个有界的SpscRing: 发送只是一次无锁入队,不加锁也不分配内存
+ * 唤醒是合并的: 接收方只有从"已排空"变为"有消息"时才投递一次排空任务(一次queueInLoop),
+ * 接收方在排空任务里把所有发往它的环一次取完,对每条消息调用handler(from, msg)
+ *
+ * send必须在loops[from]的线程中调用(每个环只有一个生产者); handler在loops[to]的线程中执行
+ * 环满时send返回false,由调用方决定重试、丢弃或退回queueInLoop
+ * 排空任务引用LoopMesh,须在所有loop退出之后再销毁
+ */
+template <typename T>
+class LoopMesh : noncopyable{
+public:
+    using MessageHandler = std::function<void(size_t from, T &msg)>;
+
+    LoopMesh(const std::vector<EventLoop *> &loops, MessageHandler handler, size_t capacity = 1024)
+        : loops_(loops)
+        , handler_(std::move(handler))
+    {
+        size_t n = loops_.size();
+        rings_.reserve(n * n);
+        for(size_t i = 0; i < n * n; ++i){
+            rings_.emplace_back(new SpscRing<T>(capacity));
+        }
+        for(size_t i = 0; i < n; ++i){
+            receivers_.emplace_back(new Receiver);
+        }
+    }
+
+    size_t size() const { return loops_.size(); }
+    EventLoop *loop(size_t index) const { return loops_[index]; }
+
+    // loop在loops中的下标,不存在时返回size()
+    size_t indexOf(EventLoop *loop) const{
+        size_t i = 0;
+        while(i < loops_.size() && loops_[i] != loop){
+            ++i;
+        }
+        return i;
+    }
+
+    template <typename U>
+    bool send(size_t from, size_t to, U &&msg){
+        if(!rings_[from * loops_.size() + to]->push(std::forward<U>(msg))){
+            return false;
+        }
+        Receiver &receiver = *receivers_[to];
+        // 与drain中的exchange(false)配对: 要么drain能看到这条消息,要么这里看到false并再次唤醒
+        if(!receiver.notified.exchange(true)){
+            loops_[to]->queueInLoop([this, to](){ drain(to); });
+        }
+        return true;
+    }
+
+    // 统计: 发往to的消息数、to执行排空的次数(两者之比即平均每次唤醒处理的消息数)
+    int64_t received(size_t to) const { return receivers_[to]->received.load(std::memory_order_relaxed); }
+    int64_t drains(size_t to) const { return receivers_[to]->drains.load(std::memory_order_relaxed); }
+
+private:
+    struct Receiver{
+        alignas(64) std::atomic_bool notified{false};
+        std::atomic<int64_t> received{0};
+        std::atomic<int64_t> drains{0};
+    };
+
+    // 在loops[to]的线程中执行
+    void drain(size_t to){
+        Receiver &receiver = *receivers_[to];
+        receiver.notified.exchange(false);
+        size_t n = loops_.size();
+        int64_t count = 0;
+        for(size_t from = 0; from < n; ++from){
+            SpscRing<T> &ring = *rings_[from * n + to];
+            // 每个环最多取一圈,排空期间新到的消息由下一次唤醒处理,避免一个发送方独占接收方
+            count += ring.consume([this, from](T &msg){ handler_(from, msg); }, ring.capacity());
+        }
+        receiver.received.fetch_add(count, std::memory_order_relaxed);
+        receiver.drains.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<EventLoop *> loops_;
+    MessageHandler handler_;
+    std::vector<std::unique_ptr<SpscRing<T>>> rings_; // rings_[from * n + to]
+    std::vector<std::unique_ptr<Receiver>> receivers_;
+};
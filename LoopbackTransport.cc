@@ -0,0 +1,106 @@
+#include "LoopbackTransport.h"
+
+#include <algorithm>
+#include <errno.h>
+
+void LoopbackTransport::createPair(TransportPtr *first, TransportPtr *second, size_t capacity){
+    std::shared_ptr<Shared> shared = std::make_shared<Shared>(capacity);
+    shared->doorbells[0] = createDoorbell();
+    shared->doorbells[1] = createDoorbell();
+    first->reset(new LoopbackTransport(shared, 0, shared->doorbells[0]));
+    second->reset(new LoopbackTransport(shared, 1, shared->doorbells[1]));
+}
+
+LoopbackTransport::LoopbackTransport(const std::shared_ptr<Shared> &shared, int side, int doorbellFd)
+    : Transport(doorbellFd)
+    , shared_(shared)
+    , side_(side)
+{
+}
+
+// 在门铃fd关闭之前(TcpConnection的Socket后于transport析构)告诉对端
+LoopbackTransport::~LoopbackTransport(){
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    shared_->alive[side_] = false;
+    output().closed = true;
+    ringPeerLocked();
+}
+
+void LoopbackTransport::ringPeerLocked() const{
+    if(shared_->alive[1 - side_]){
+        ring(shared_->doorbells[1 - side_]);
+    }
+}
+
+bool LoopbackTransport::readable() const{
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    return input().data.readableBytes() > 0 || input().closed;
+}
+
+bool LoopbackTransport::writable() const{
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    return output().data.readableBytes() < shared_->capacity || !shared_->alive[1 - side_];
+}
+
+ssize_t LoopbackTransport::read(Buffer *buf, size_t maxBytes, int *savedErrno){
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    Pipe &in = input();
+    size_t available = in.data.readableBytes();
+    if(available == 0){
+        if(in.closed){
+            return 0;
+        }
+        *savedErrno = EAGAIN;
+        return -1;
+    }
+    size_t n = maxBytes > 0 ? std::min(available, maxBytes) : available;
+    buf->append(in.data.peek(), n);
+    in.data.retrieve(n);
+    if(in.writerWaiting){
+        in.writerWaiting = false;
+        ringPeerLocked();
+    }
+    // 受读预算限制没读完的数据不会再有新的通知,相当于水平触发
+    if(in.data.readableBytes() > 0){
+        ring();
+    }
+    return static_cast<ssize_t>(n);
+}
+
+ssize_t LoopbackTransport::write(const struct iovec *iov, int iovcnt){
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    Pipe &out = output();
+    if(out.closed || !shared_->alive[1 - side_]){
+        errno = EPIPE;
+        return -1;
+    }
+    size_t space = shared_->capacity - std::min(shared_->capacity, out.data.readableBytes());
+    if(space == 0){
+        out.writerWaiting = true;
+        errno = EWOULDBLOCK;
+        return -1;
+    }
+    bool wasEmpty = out.data.readableBytes() == 0;
+    size_t written = 0;
+    for(int i = 0; i < iovcnt && written < space; ++i){
+        size_t n = std::min(iov[i].iov_len, space - written);
+        out.data.append(static_cast<const char *>(iov[i].iov_base), n);
+        written += n;
+    }
+    if(out.data.readableBytes() >= shared_->capacity){
+        out.writerWaiting = true;
+    }
+    // 对端在取空之前不会睡着,只在由空变为非空时敲门铃
+    if(wasEmpty && written > 0){
+        ringPeerLocked();
+    }
+    return static_cast<ssize_t>(written);
+}
+
+void LoopbackTransport::shutdownWrite(){
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    if(!output().closed){
+        output().closed = true;
+        ringPeerLocked();
+    }
+}
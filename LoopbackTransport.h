@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Transport.h"
+#include "Buffer.h"
+
+#include <memory>
+#include <mutex>
+
+/**
+ * 进程内的内存连接: 一对端点,每个方向一个有界的Buffer,写入后敲对端的门铃,完全不经过内核协议栈
+ * 把两端分别交给TcpServer::acceptTransport与TcpClient::connect(TransportPtr),
+ * 同一套MessageCallback就能在没有socket开销的情况下运行,用于单独测量框架与业务回调的开销
+ *
+ * 与socket一样有发送空间的限制(capacity),写满后返回EWOULDBLOCK,由TcpConnection照常排队等待;
+ * 一端关闭写端后另一端读完剩余数据再读到0, 一端销毁后另一端的写入失败(EPIPE)
+ */
+class LoopbackTransport : public Transport{
+public:
+    static const size_t kDefaultCapacity = 256 * 1024;
+
+    // 创建一对相连的端点
+    static void createPair(TransportPtr *first, TransportPtr *second, size_t capacity = kDefaultCapacity);
+    ~LoopbackTransport() override;
+
+    bool readable() const override;
+    bool writable() const override;
+    ssize_t read(Buffer *buf, size_t maxBytes, int *savedErrno) override;
+    ssize_t write(const struct iovec *iov, int iovcnt) override;
+    void shutdownWrite() override;
+
+private:
+    // 一个方向的数据
+    struct Pipe{
+        Buffer data;
+        bool closed = false;        // 写端已关闭
+        bool writerWaiting = false; // 写端在等待发送空间
+    };
+    // 两个端点共享,一把锁保护两个方向(每次操作只做一次拷贝)
+    struct Shared{
+        explicit Shared(size_t cap) : capacity(cap) {}
+        std::mutex mutex;
+        const size_t capacity;
+        Pipe pipes[2];         // pipes[i]由端点i写入,另一端读取
+        int doorbells[2];
+        bool alive[2] = {true, true}; // 端点销毁后不能再敲它的门铃(fd可能已被复用)
+    };
+
+    LoopbackTransport(const std::shared_ptr<Shared> &shared, int side, int doorbellFd);
+
+    Pipe &input() const { return shared_->pipes[1 - side_]; }
+    Pipe &output() const { return shared_->pipes[side_]; }
+    void ringPeerLocked() const;
+
+    std::shared_ptr<Shared> shared_;
+    const int side_;
+};
@@ -0,0 +1,63 @@
+#include "OutputBudget.h"
+#include "TcpConnection.h"
+
+#include <algorithm>
+
+void OutputBudget::LoopCounter::add(int64_t delta){
+    bytes_.store(bytes_.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    unpublished_ += delta;
+    if(unpublished_ >= kPublishBytes || unpublished_ <= -kPublishBytes){
+        budget_->publish(unpublished_);
+        unpublished_ = 0;
+    }
+}
+
+OutputBudget::OutputBudget(size_t maxBytes, const ExceededCallback &cb)
+    : maxBytes_(maxBytes)
+    , exceededCallback_(cb)
+    , publishedBytes_(0)
+    , checkPending_(false)
+{}
+
+OutputBudget::LoopCounter *OutputBudget::counterOf(EventLoop *loop){
+    std::unique_ptr<LoopCounter> &counter = counters_[loop];
+    if(!counter){
+        counter.reset(new LoopCounter(this));
+    }
+    return counter.get();
+}
+
+size_t OutputBudget::totalBytes() const{
+    int64_t total = 0;
+    for(const auto &item : counters_){
+        total += item.second->bytes();
+    }
+    return total > 0 ? static_cast<size_t>(total) : 0;
+}
+
+void OutputBudget::publish(int64_t delta){
+    int64_t total = publishedBytes_.fetch_add(delta, std::memory_order_relaxed) + delta;
+    if(delta > 0 && total > static_cast<int64_t>(maxBytes_) && !checkPending_.exchange(true)){
+        exceededCallback_();
+    }
+}
+
+void OutputBudget::evictLargestFirst(std::vector<OutputStat> &stats){
+    std::sort(stats.begin(), stats.end(), [](const OutputStat &a, const OutputStat &b){
+        return a.bytes > b.bytes;
+    });
+}
+
+void OutputBudget::evictLongestStalledFirst(std::vector<OutputStat> &stats){
+    std::sort(stats.begin(), stats.end(), [](const OutputStat &a, const OutputStat &b){
+        bool aStalled = a.highWaterSince.valid();
+        bool bStalled = b.highWaterSince.valid();
+        if(aStalled != bStalled){
+            return aStalled;
+        }
+        if(aStalled && a.highWaterSince != b.highWaterSince){
+            return a.highWaterSince < b.highWaterSince;
+        }
+        return a.bytes > b.bytes;
+    });
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class EventLoop;
+
+/**
+ * TcpServer内所有连接outputBuffer_的总内存预算
+ * 每个subloop一个LoopCounter,只由所属loop线程修改(无竞争);
+ * 累计变化量超过kPublishBytes才汇总到全局计数,全局计数超过预算时通知mainloop淘汰连接
+ * 全局计数的误差不超过 loop个数 * kPublishBytes
+ */
+class OutputBudget : noncopyable {
+public:
+    // 一个连接待发送数据的快照,供淘汰策略使用
+    struct OutputStat {
+        TcpConnectionPtr conn;
+        size_t bytes;              // outputBuffer_中待发送的字节数
+        Timestamp highWaterSince;  // 超过高水位的起始时间,未超过为无效时间
+    };
+    // 淘汰策略: 把stats按淘汰的优先级排序,TcpServer从前往后关闭连接直到低于预算
+    using EvictionPolicy = std::function<void(std::vector<OutputStat> &)>;
+    using ExceededCallback = std::function<void()>;
+
+    static const int64_t kPublishBytes = 64 * 1024;
+    // 淘汰后仍超预算时(被关闭的连接还没释放内存,或其余连接的数据还在增长),隔这么久(秒)再检查一次
+    static constexpr double kRecheckInterval = 0.1;
+
+    class LoopCounter : noncopyable {
+    public:
+        explicit LoopCounter(OutputBudget *budget)
+            : budget_(budget), bytes_(0), unpublished_(0) {}
+        // 只能在所属loop线程调用
+        void add(int64_t delta);
+        int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    private:
+        OutputBudget *budget_;
+        std::atomic<int64_t> bytes_; // 该loop上所有连接待发送字节数的精确值
+        int64_t unpublished_;        // 尚未汇总到全局计数的变化量
+    };
+
+    OutputBudget(size_t maxBytes, const ExceededCallback &cb);
+
+    // 获取loop对应的计数器,只在mainloop中调用
+    LoopCounter *counterOf(EventLoop *loop);
+    // 汇总所有loop的精确值
+    size_t totalBytes() const;
+    size_t maxBytes() const { return maxBytes_; }
+
+    // 检查时已不超预算,允许再次通知; 仍超预算时不调用,由mainloop定时重新检查
+    void checkDone() { checkPending_ = false; }
+
+    // 待发送数据最多的连接优先淘汰
+    static void evictLargestFirst(std::vector<OutputStat> &stats);
+    // 超过高水位最久的连接优先淘汰,其余按待发送数据量排序
+    static void evictLongestStalledFirst(std::vector<OutputStat> &stats);
+
+private:
+    void publish(int64_t delta);
+
+    const size_t maxBytes_;
+    ExceededCallback exceededCallback_;
+    std::atomic<int64_t> publishedBytes_; // 全局计数(近似值)
+    std::atomic_bool checkPending_;       // 防止重复通知mainloop
+    std::unordered_map<EventLoop *, std::unique_ptr<LoopCounter>> counters_;
+};
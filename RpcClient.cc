@@ -0,0 +1,82 @@
+#include "RpcClient.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+RpcClient::RpcClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &name)
+    : loop_(loop)
+    , client_(loop, serverAddr, name)
+    , codec_(std::bind(&RpcClient::onFrame, this, std::placeholders::_1, std::placeholders::_2,
+                       std::placeholders::_3, std::placeholders::_4))
+    , nextId_(1)
+{
+    client_.setConnectionCallback(std::bind(&RpcClient::onConnection, this, std::placeholders::_1));
+    client_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_,
+                                         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    client_.enableRetry();
+}
+
+bool RpcClient::connected() const{
+    TcpConnectionPtr conn = client_.connection();
+    return conn && conn->connected();
+}
+
+void RpcClient::call(const std::string &method, const std::string &request, const RpcCallback &cb){
+    int64_t id = nextId_++;
+    Buffer buf(rpc::kRequestHeaderLen + method.size() + request.size());
+    if(!rpc::encodeRequest(&buf, id, method, request)){
+        LOG_ERROR("RpcClient::call [%s] method name too long: %zu bytes \n", client_.name().c_str(), method.size());
+        loop_->runInLoop(std::bind(cb, rpc::kBadRequest, std::string()));
+        return;
+    }
+    buf.prependInt32(static_cast<int32_t>(buf.readableBytes())); // 长度头
+    if(loop_->isInLoopThread()){
+        callInLoop(id, buf.retrieveAllAsString(), cb);
+    }
+    else{
+        loop_->queueInLoop(std::bind(&RpcClient::callInLoop, this, id, buf.retrieveAllAsString(), cb));
+    }
+}
+
+void RpcClient::callInLoop(int64_t id, const std::string &frame, const RpcCallback &cb){
+    TcpConnectionPtr conn = client_.connection();
+    if(!conn || !conn->connected()){
+        cb(rpc::kConnectionLost, std::string());
+        return;
+    }
+    pending_[id] = cb;
+    conn->send(frame);
+}
+
+// 在loop_线程中执行: 连接断开时,所有未完成的调用以kConnectionLost结束
+void RpcClient::onConnection(const TcpConnectionPtr &conn){
+    if(conn->connected()){
+        conn->setTcpNoDelay(true);
+        return;
+    }
+    std::unordered_map<int64_t, RpcCallback> pending;
+    pending.swap(pending_);
+    for(auto &item : pending){
+        item.second(rpc::kConnectionLost, std::string());
+    }
+}
+
+void RpcClient::onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, Timestamp){
+    if(len < rpc::kResponseHeaderLen || data[0] != rpc::kResponse){
+        LOG_ERROR("RpcClient::onFrame [%s] malformed response \n", client_.name().c_str());
+        conn->forceClose();
+        return;
+    }
+    int64_t id = rpc::readInt64(data + 1);
+    rpc::Status status = static_cast<rpc::Status>(data[9]);
+    auto it = pending_.find(id);
+    if(it == pending_.end()){
+        LOG_ERROR("RpcClient::onFrame [%s] unknown id %ld \n", client_.name().c_str(), id);
+        return;
+    }
+    RpcCallback cb;
+    cb.swap(it->second);
+    pending_.erase(it);
+    const char *body = data + rpc::kResponseHeaderLen;
+    cb(status, std::string(body, data + len - body));
+}
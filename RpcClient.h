@@ -0,0 +1,46 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TcpClient.h"
+#include "LengthHeaderCodec.h"
+#include "RpcMessage.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+class EventLoop;
+
+/**
+ * RPC客户端: 所有调用复用一个连接,每个调用分配一个id,响应到达后按id找到回调
+ * call可在任意线程调用; 回调在loop_所在线程执行
+ */
+class RpcClient : noncopyable {
+public:
+    using RpcCallback = std::function<void(rpc::Status status, const std::string &response)>;
+
+    RpcClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &name);
+
+    // 非阻塞地发起连接,连接断开后自动重连
+    void connect() { client_.connect(); }
+    void disconnect() { client_.disconnect(); }
+    bool connected() const;
+
+    // 方法名超过rpc::kMaxMethodLength时不发送,回调以kBadRequest结束
+    void call(const std::string &method, const std::string &request, const RpcCallback &cb);
+
+private:
+    void callInLoop(int64_t id, const std::string &frame, const RpcCallback &cb);
+    void onConnection(const TcpConnectionPtr &conn);
+    void onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, Timestamp receiveTime);
+
+    EventLoop *loop_;
+    TcpClient client_;
+    LengthHeaderCodec codec_;
+
+    std::atomic<int64_t> nextId_;
+    std::unordered_map<int64_t, RpcCallback> pending_; // 未完成的调用,只在loop_线程访问
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <string>
+#include <stdint.h>
+
+/**
+ * RPC消息格式,每个消息作为LengthHeaderCodec的一个frame发送:
+ *   请求: [int8 kRequest][int64 id][int16 方法名长度][方法名][请求内容]
+ *   响应: [int8 kResponse][int64 id][int8 status][响应内容]
+ * 同一连接上可以有多个未完成的请求,响应通过id与请求对应,可以乱序返回
+ */
+namespace rpc{
+
+enum MessageType : int8_t{
+    kRequest = 0,
+    kResponse = 1,
+};
+
+enum Status : int8_t{
+    kOk = 0,
+    kNoSuchMethod = 1,
+    kBadRequest = 2,
+    kConnectionLost = 3, // 客户端本地产生: 连接断开时未完成的调用
+};
+
+static const size_t kRequestHeaderLen = sizeof(int8_t) + sizeof(int64_t) + sizeof(int16_t);
+static const size_t kResponseHeaderLen = sizeof(int8_t) + sizeof(int64_t) + sizeof(int8_t);
+static const size_t kMaxMethodLength = UINT16_MAX; // 方法名长度用16位编码
+
+// 方法名超过kMaxMethodLength时返回false,不写入buf
+inline bool encodeRequest(Buffer *buf, int64_t id, const std::string &method, const std::string &request){
+    if(method.size() > kMaxMethodLength){
+        return false;
+    }
+    buf->appendInt8(kRequest);
+    buf->appendInt64(id);
+    buf->appendInt16(static_cast<int16_t>(method.size()));
+    buf->append(method.data(), method.size());
+    buf->append(request.data(), request.size());
+    return true;
+}
+
+inline void encodeResponse(Buffer *buf, int64_t id, Status status, const std::string &response){
+    buf->appendInt8(kResponse);
+    buf->appendInt64(id);
+    buf->appendInt8(status);
+    buf->append(response.data(), response.size());
+}
+
+// 从frame[data, data+len)中读取网络字节序整数
+inline int64_t readInt64(const char *data){
+    int64_t be64 = 0;
+    ::memcpy(&be64, data, sizeof(be64));
+    return be64toh(be64);
+}
+inline int16_t readInt16(const char *data){
+    int16_t be16 = 0;
+    ::memcpy(&be16, data, sizeof(be16));
+    return be16toh(be16);
+}
+
+} // namespace rpc
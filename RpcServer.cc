@@ -0,0 +1,59 @@
+#include "RpcServer.h"
+#include "logger.h"
+
+RpcServer::RpcServer(EventLoop *loop,
+                     const InetAddress &listenAddr,
+                     const std::string &name,
+                     size_t maxFrameSize)
+    : server_(loop, listenAddr, name)
+    , codec_(std::bind(&RpcServer::onFrame, this, std::placeholders::_1, std::placeholders::_2,
+                       std::placeholders::_3, std::placeholders::_4),
+             maxFrameSize)
+{
+    server_.setConnectionCallback(std::bind(&RpcServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_,
+                                         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void RpcServer::onConnection(const TcpConnectionPtr &conn){
+    if(conn->connected()){
+        conn->setTcpNoDelay(true);
+    }
+}
+
+void RpcServer::onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, Timestamp){
+    if(len < rpc::kRequestHeaderLen || data[0] != rpc::kRequest){
+        LOG_ERROR("RpcServer::onFrame [%s] malformed request \n", conn->name().c_str());
+        conn->forceClose();
+        return;
+    }
+    int64_t id = rpc::readInt64(data + 1);
+    size_t methodLen = static_cast<uint16_t>(rpc::readInt16(data + 9));
+    if(len < rpc::kRequestHeaderLen + methodLen){
+        sendResponse(conn, id, rpc::kBadRequest, std::string());
+        return;
+    }
+    const char *method = data + rpc::kRequestHeaderLen;
+    auto it = handlers_.find(std::string(method, methodLen));
+    if(it == handlers_.end()){
+        sendResponse(conn, id, rpc::kNoSuchMethod, std::string());
+        return;
+    }
+    const char *body = method + methodLen;
+    std::string request(body, data + len - body);
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    it->second(request, [weakConn, id](const std::string &response){
+        sendResponse(weakConn, id, rpc::kOk, response);
+    });
+}
+
+void RpcServer::sendResponse(const std::weak_ptr<TcpConnection> &weakConn, int64_t id,
+                             rpc::Status status, const std::string &response){
+    TcpConnectionPtr conn = weakConn.lock();
+    if(conn){
+        Buffer buf(rpc::kResponseHeaderLen + response.size());
+        rpc::encodeResponse(&buf, id, status, response);
+        buf.prependInt32(static_cast<int32_t>(buf.readableBytes())); // 长度头
+        conn->send(&buf);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+#include "LengthHeaderCodec.h"
+#include "RpcMessage.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * 多路复用的RPC服务端: 一个连接上可以同时有多个未完成的请求
+ * 处理函数可以在任意线程、任意时刻调用RpcDone返回结果,响应按完成顺序发送
+ */
+class RpcServer : noncopyable {
+public:
+    // 返回一个请求的结果,可在任意线程调用,只能调用一次
+    using RpcDone = std::function<void(const std::string &response)>;
+    using RpcHandler = std::function<void(const std::string &request, const RpcDone &done)>;
+
+    RpcServer(EventLoop *loop,
+              const InetAddress &listenAddr,
+              const std::string &name,
+              size_t maxFrameSize = LengthHeaderCodec::kDefaultMaxFrameSize);
+
+    // 需在start之前注册
+    void registerMethod(const std::string &method, const RpcHandler &handler)
+    { handlers_[method] = handler; }
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, Timestamp receiveTime);
+
+    // 连接可能在处理函数返回结果前断开,所以RpcDone只持有weak_ptr
+    static void sendResponse(const std::weak_ptr<TcpConnection> &weakConn, int64_t id,
+                             rpc::Status status, const std::string &response);
+
+    TcpServer server_;
+    LengthHeaderCodec codec_;
+    std::unordered_map<std::string, RpcHandler> handlers_; // start之后只读,无需加锁
+};
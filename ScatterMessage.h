@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+/**
+ * 由若干不连续的数据块组成的待发送消息,交给TcpConnection::send后用writev直接发送,
+ * 没写进内核的尾部中,引用计数的数据块只保留引用,其余的才拷贝进outputBuffer_
+ * - append(data, len): 引用调用方的内存,在loop线程中send时,send返回后即可释放
+ * - append(slice): 持有引用计数的数据块,跨线程send时只增加引用计数而不拷贝
+ * 含有append(data, len)块的消息跨线程send时会先拼接成一份拷贝
+ */
+class ScatterMessage{
+public:
+    using Slice = std::shared_ptr<const std::string>;
+
+    ScatterMessage() : bytes_(0), borrowed_(0) {}
+
+    ScatterMessage &append(const void *data, size_t len){
+        if(len > 0){
+            iov_.push_back(iovec{const_cast<void *>(data), len});
+            slices_.push_back(Slice());
+            bytes_ += len;
+            ++borrowed_;
+        }
+        return *this;
+    }
+
+    ScatterMessage &append(const Slice &slice){
+        if(slice && !slice->empty()){
+            iov_.push_back(iovec{const_cast<char *>(slice->data()), slice->size()});
+            slices_.push_back(slice);
+            bytes_ += slice->size();
+        }
+        return *this;
+    }
+
+    const iovec *iov() const { return iov_.data(); }
+    int iovcnt() const { return static_cast<int>(iov_.size()); }
+    // 与iov()一一对应,引用调用方内存的块为空
+    const Slice *slices() const { return slices_.data(); }
+    size_t size() const { return bytes_; }
+    // 是否引用了调用方的内存(而非全部由自己持有)
+    bool borrowsMemory() const { return borrowed_ > 0; }
+
+    void clear(){
+        iov_.clear();
+        slices_.clear();
+        bytes_ = 0;
+        borrowed_ = 0;
+    }
+
+private:
+    std::vector<iovec> iov_;
+    std::vector<Slice> slices_; // 保证引用计数数据块在发送前有效,与iov_一一对应
+    size_t bytes_;
+    int borrowed_; // 引用调用方内存的块数
+};
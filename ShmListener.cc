@@ -0,0 +1,85 @@
+#include "ShmListener.h"
+#include "ShmTransport.h"
+#include "EventLoop.h"
+#include "TcpServer.h"
+#include "logger.h"
+
+#include <unistd.h>
+
+ShmListener::ShmListener(EventLoop *loop, const InetAddress &listenAddr, TcpServer *server)
+    : loop_(loop)
+    , acceptor_(loop, listenAddr, false)
+    , server_(server)
+{
+    acceptor_.setNewConnectionCallback([this](int sockfd, const InetAddress &peerAddr){
+        newConnection(sockfd, peerAddr);
+    });
+}
+
+ShmListener::~ShmListener(){
+    for(auto &item : pending_){
+        loop_->cancel(item.second.timer);
+        item.second.channel->disableAll();
+        item.second.channel->remove();
+        ::close(item.first);
+    }
+}
+
+void ShmListener::listen(){
+    loop_->runInLoop([this](){ acceptor_.listen(); });
+}
+
+void ShmListener::newConnection(int sockfd, const InetAddress &peerAddr){
+    // 客户端connect之后立即发送握手消息,通常此时已经到达
+    if(tryHandshake(sockfd, peerAddr)){
+        ::close(sockfd); // 握手完成后不再需要Unix socket
+        return;
+    }
+    std::unique_ptr<Channel> channel(new Channel(loop_, sockfd));
+    channel->setReadCallback([this, sockfd, peerAddr](Timestamp){ handlePendingRead(sockfd, peerAddr); });
+    channel->enableReading();
+    // 握手完成或超时关闭时取消定时器,sockfd被复用时不会误关新的socket
+    TimerId timer = loop_->runAfter(kHandshakeTimeout, [this, sockfd](){ handleTimeout(sockfd); });
+    pending_[sockfd] = Pending{std::move(channel), timer};
+}
+
+// 收到握手消息后把transport交给server,不关闭sockfd
+bool ShmListener::tryHandshake(int sockfd, const InetAddress &peerAddr){
+    bool wouldBlock = false;
+    TransportPtr transport = ShmTransport::accept(sockfd, &wouldBlock);
+    if(wouldBlock){
+        return false;
+    }
+    if(transport){
+        server_->acceptTransport(std::move(transport), peerAddr);
+    }
+    return true;
+}
+
+void ShmListener::handlePendingRead(int sockfd, const InetAddress &peerAddr){
+    auto it = pending_.find(sockfd);
+    if(it == pending_.end() || !tryHandshake(sockfd, peerAddr)){
+        return;
+    }
+    loop_->cancel(it->second.timer);
+    it->second.channel->disableAll();
+    it->second.channel->remove();
+    ::close(sockfd);
+    // 正在执行这个Channel的回调,之后再销毁它
+    std::shared_ptr<Channel> channel(it->second.channel.release());
+    pending_.erase(it);
+    loop_->queueInLoop([channel](){});
+}
+
+// 客户端迟迟不发送握手消息,关闭socket以免一直占用fd
+void ShmListener::handleTimeout(int sockfd){
+    auto it = pending_.find(sockfd);
+    if(it == pending_.end()){
+        return;
+    }
+    LOG_ERROR("ShmListener handshake timeout on fd=%d \n", sockfd);
+    it->second.channel->disableAll();
+    it->second.channel->remove();
+    ::close(sockfd);
+    pending_.erase(it);
+}
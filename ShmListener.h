@@ -0,0 +1,48 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Acceptor.h"
+#include "Channel.h"
+#include "InetAddress.h"
+#include "TimerQueue.h"
+
+#include <map>
+#include <memory>
+
+class EventLoop;
+class TcpServer;
+
+/**
+ * 在Unix域socket上接受ShmTransport连接: 完成握手后把服务端的一端交给server->acceptTransport,
+ * 之后与accept到的TCP连接一样分配subloop、执行server的回调
+ * 握手消息还没到的socket先登记在poller中等待可读,不阻塞loop; 超过kHandshakeTimeout秒仍未完成的关闭
+ */
+class ShmListener : noncopyable{
+public:
+    static constexpr double kHandshakeTimeout = 5.0;
+
+    // listenAddr须为Unix域地址,见InetAddress::unixAddress
+    ShmListener(EventLoop *loop, const InetAddress &listenAddr, TcpServer *server);
+    ~ShmListener();
+
+    // 开始监听,需在server->start()之后调用
+    void listen();
+
+private:
+    void newConnection(int sockfd, const InetAddress &peerAddr);
+    // 完成或放弃握手时返回true
+    bool tryHandshake(int sockfd, const InetAddress &peerAddr);
+    void handlePendingRead(int sockfd, const InetAddress &peerAddr);
+    void handleTimeout(int sockfd);
+
+    // 等待握手消息的socket
+    struct Pending{
+        std::unique_ptr<Channel> channel;
+        TimerId timer;
+    };
+
+    EventLoop *loop_;
+    Acceptor acceptor_;
+    TcpServer *server_;
+    std::map<int, Pending> pending_;
+};
@@ -0,0 +1,395 @@
+#include "ShmTransport.h"
+#include "Buffer.h"
+#include "InetAddress.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+// 一个方向的环. head/tail只增不减,对容量取模得到在数据区中的位置
+struct ShmRing{
+    alignas(64) std::atomic<uint64_t> head; // 读取方已取走的位置
+    alignas(64) std::atomic<uint64_t> tail; // 写入方已写入的位置
+    alignas(64) std::atomic<uint32_t> writerWaiting; // 写入方在等待空间,读取方取走数据后敲它的门铃
+    std::atomic<uint32_t> closed; // 写入方已关闭写端,在最后一次写入之后设置
+};
+
+// 共享内存开头的控制块,之后按页对齐依次是rings[0]与rings[1]的数据区
+struct ShmControl{
+    uint64_t magic;
+    uint64_t capacity;
+    std::atomic<uint32_t> alive[2]; // 端点析构后清零,对端的写入随即失败
+    ShmRing rings[2]; // rings[i]由side i写入
+};
+
+namespace{
+
+const uint64_t kMagic = 0x314d48534f44554dULL; // "MUDOSHM1"
+const size_t kPageSize = 4096;
+const size_t kDataOffset = (sizeof(ShmControl) + kPageSize - 1) / kPageSize * kPageSize;
+
+// 握手消息,随消息通过SCM_RIGHTS传递memfd、客户端门铃与服务端门铃
+struct Hello{
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t mappedSize;
+};
+const int kHelloFds = 3;
+// 服务端映射之后,共享内存的大小不能再被客户端改变(缩小会让访问它的线程收到SIGBUS)
+const int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_GROW;
+
+size_t roundUpPowerOfTwo(size_t n){
+    size_t capacity = kPageSize;
+    while(capacity < n){
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+void copyIn(char *data, size_t capacity, uint64_t pos, const char *src, size_t len){
+    size_t offset = pos & (capacity - 1);
+    size_t first = std::min(len, capacity - offset);
+    ::memcpy(data + offset, src, first);
+    ::memcpy(data, src + first, len - first);
+}
+
+void copyOut(const char *data, size_t capacity, uint64_t pos, char *dst, size_t len){
+    size_t offset = pos & (capacity - 1);
+    size_t first = std::min(len, capacity - offset);
+    ::memcpy(dst, data + offset, first);
+    ::memcpy(dst + first, data, len - first);
+}
+
+// 客户端传来的门铃必须是eventfd: 换成阻塞的管道或socket,服务端敲门铃时会卡住loop,
+// 或者登记进poller的fd永远不可读. 通过检查的fd设为非阻塞
+bool checkDoorbell(int fd){
+    char path[64];
+    char target[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    ssize_t n = ::readlink(path, target, sizeof(target) - 1);
+    if(n < 0){
+        return false;
+    }
+    target[n] = '\0';
+    static const char kEventfd[] = "anon_inode:[eventfd]";
+    if(::strcmp(target, kEventfd) != 0){
+        return false;
+    }
+    int flags = ::fcntl(fd, F_GETFL);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool writeAll(int fd, const void *data, size_t len){
+    const char *p = static_cast<const char *>(data);
+    while(len > 0){
+        ssize_t n = ::write(fd, p, len);
+        if(n <= 0){
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+} // namespace
+
+TransportPtr ShmTransport::connect(const InetAddress &listenAddr, size_t capacity){
+    capacity = roundUpPowerOfTwo(capacity);
+    size_t mappedSize = kDataOffset + 2 * capacity;
+    int memfd = ::memfd_create("mymuduo-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(memfd < 0){
+        LOG_ERROR("ShmTransport::connect memfd_create error:%d \n", errno);
+        return TransportPtr();
+    }
+    if(::ftruncate(memfd, static_cast<off_t>(mappedSize)) < 0
+       || ::fcntl(memfd, F_ADD_SEALS, kRequiredSeals) < 0){
+        LOG_ERROR("ShmTransport::connect ftruncate/seal error:%d \n", errno);
+        ::close(memfd);
+        return TransportPtr();
+    }
+    void *base = ::mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, memfd, 0);
+    if(base == MAP_FAILED){
+        LOG_ERROR("ShmTransport::connect mmap error:%d \n", errno);
+        ::close(memfd);
+        return TransportPtr();
+    }
+    ShmControl *control = new (base) ShmControl;
+    control->magic = kMagic;
+    control->capacity = capacity;
+    for(int side = 0; side < 2; ++side){
+        control->alive[side].store(1, std::memory_order_relaxed);
+        control->rings[side].head.store(0, std::memory_order_relaxed);
+        control->rings[side].tail.store(0, std::memory_order_relaxed);
+        control->rings[side].writerWaiting.store(0, std::memory_order_relaxed);
+        control->rings[side].closed.store(0, std::memory_order_relaxed);
+    }
+    int doorbells[2] = {createDoorbell(), createDoorbell()};
+
+    // 握手: 发送共享内存与两个门铃,等待服务端确认
+    bool ok = false;
+    int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sockfd >= 0 && ::connect(sockfd, listenAddr.getSockAddr(), listenAddr.getSockLen()) == 0){
+        Hello hello = {kMagic, capacity, mappedSize};
+        struct iovec iov;
+        iov.iov_base = &hello;
+        iov.iov_len = sizeof(hello);
+        int fds[kHelloFds] = {memfd, doorbells[0], doorbells[1]};
+        char cmsgBuf[CMSG_SPACE(sizeof(fds))];
+        ::memset(cmsgBuf, 0, sizeof(cmsgBuf));
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsgBuf;
+        msg.msg_controllen = sizeof(cmsgBuf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        ::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        char ack = 0;
+        ok = ::sendmsg(sockfd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(hello))
+             && ::read(sockfd, &ack, 1) == 1 && ack == 'k';
+    }
+    if(!ok){
+        LOG_ERROR("ShmTransport::connect handshake with %s failed, errno:%d \n", listenAddr.toIpPort().c_str(), errno);
+    }
+    if(sockfd >= 0){
+        ::close(sockfd);
+    }
+    ::close(memfd); // 映射保持有效
+    if(!ok){
+        ::munmap(base, mappedSize);
+        ::close(doorbells[0]);
+        ::close(doorbells[1]);
+        return TransportPtr();
+    }
+    return TransportPtr(new ShmTransport(base, mappedSize, capacity, 0, doorbells[0], doorbells[1]));
+}
+
+TransportPtr ShmTransport::accept(int sockfd, bool *wouldBlock){
+    *wouldBlock = false;
+    Hello hello;
+    struct iovec iov;
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+    char cmsgBuf[CMSG_SPACE(sizeof(int) * kHelloFds)];
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgBuf;
+    msg.msg_controllen = sizeof(cmsgBuf);
+    ssize_t n = ::recvmsg(sockfd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+        *wouldBlock = true;
+        return TransportPtr();
+    }
+    int fds[kHelloFds] = {-1, -1, -1};
+    struct cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+       && cmsg->cmsg_len == CMSG_LEN(sizeof(fds))){
+        ::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    }
+    else if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS){
+        // fd个数不对,收到的fd也要关闭
+        int count = static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for(int i = 0; i < count; ++i){
+            int fd;
+            ::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            ::close(fd);
+        }
+    }
+
+    void *base = MAP_FAILED;
+    struct stat st;
+    bool valid = n == static_cast<ssize_t>(sizeof(hello)) && fds[0] >= 0 && hello.magic == kMagic
+                 && hello.capacity >= kPageSize && (hello.capacity & (hello.capacity - 1)) == 0
+                 && hello.mappedSize == kDataOffset + 2 * hello.capacity
+                 && (::fcntl(fds[0], F_GET_SEALS) & kRequiredSeals) == kRequiredSeals
+                 && ::fstat(fds[0], &st) == 0 && static_cast<uint64_t>(st.st_size) >= hello.mappedSize
+                 && checkDoorbell(fds[1]) && checkDoorbell(fds[2]);
+    if(valid){
+        base = ::mmap(nullptr, hello.mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fds[0], 0);
+    }
+    if(fds[0] >= 0){
+        ::close(fds[0]);
+    }
+    if(base == MAP_FAILED){
+        LOG_ERROR("ShmTransport::accept invalid handshake on fd=%d \n", sockfd);
+        if(fds[1] >= 0){
+            ::close(fds[1]);
+            ::close(fds[2]);
+        }
+        return TransportPtr();
+    }
+    TransportPtr transport(new ShmTransport(base, hello.mappedSize, hello.capacity, 1, fds[2], fds[1]));
+    char ack = 'k';
+    writeAll(sockfd, &ack, 1);
+    return transport;
+}
+
+ShmTransport::ShmTransport(void *base, size_t mappedSize, size_t capacity, int side, int doorbellFd,
+                           int peerDoorbellFd)
+    : Transport(doorbellFd)
+    , control_(static_cast<ShmControl *>(base))
+    , mappedSize_(mappedSize)
+    , capacity_(capacity)
+    , side_(side)
+    , peerDoorbellFd_(peerDoorbellFd)
+    , readPos_(0)
+    , writePos_(0)
+    , protocolError_(false)
+{
+}
+
+ShmTransport::~ShmTransport(){
+    control_->rings[side_].closed.store(1, std::memory_order_release);
+    control_->alive[side_].store(0, std::memory_order_release);
+    ring(peerDoorbellFd_);
+    ::munmap(control_, mappedSize_);
+    ::close(peerDoorbellFd_);
+}
+
+char *ShmTransport::ringData(int side) const{
+    return reinterpret_cast<char *>(control_) + kDataOffset + side * capacity_;
+}
+
+// 对端写坏了共享内存中的位置: 当作对端关闭,read返回0、write返回EPIPE,由TcpConnection关闭连接
+void ShmTransport::setProtocolError(uint64_t head, uint64_t tail){
+    if(!protocolError_){
+        LOG_ERROR("ShmTransport fd=%d protocol error: head=%lu tail=%lu capacity=%zu \n", fd(),
+                  static_cast<unsigned long>(head), static_cast<unsigned long>(tail), capacity_);
+        protocolError_ = true;
+        ring();
+    }
+}
+
+bool ShmTransport::readable() const{
+    const ShmRing &in = control_->rings[1 - side_];
+    return protocolError_ || in.tail.load(std::memory_order_acquire) != readPos_
+           || in.closed.load(std::memory_order_acquire);
+}
+
+// 已用空间超过容量也返回true,由write发现错误
+bool ShmTransport::writable() const{
+    const ShmRing &out = control_->rings[side_];
+    return protocolError_ || writePos_ - out.head.load(std::memory_order_acquire) != capacity_
+           || !control_->alive[1 - side_].load(std::memory_order_acquire);
+}
+
+ssize_t ShmTransport::read(Buffer *buf, size_t maxBytes, int *savedErrno){
+    if(protocolError_){
+        return 0;
+    }
+    // head由本端维护,只信任本地的副本; 对端写入的tail须在[head, head + capacity_]之内
+    ShmRing &in = control_->rings[1 - side_];
+    uint64_t head = readPos_;
+    uint64_t tail = in.tail.load(std::memory_order_acquire);
+    if(tail - head > capacity_){
+        setProtocolError(head, tail);
+        return 0;
+    }
+    if(tail == head){
+        if(!in.closed.load(std::memory_order_acquire)){
+            *savedErrno = EAGAIN;
+            return -1;
+        }
+        // closed在最后一次写入之后设置,再看一次有没有剩下的数据
+        tail = in.tail.load(std::memory_order_acquire);
+        if(tail == head){
+            return 0;
+        }
+        if(tail - head > capacity_){
+            setProtocolError(head, tail);
+            return 0;
+        }
+    }
+    size_t n = static_cast<size_t>(tail - head);
+    if(maxBytes > 0){
+        n = std::min(n, maxBytes);
+    }
+    buf->ensureWriteableBytes(n);
+    copyOut(ringData(1 - side_), capacity_, head, buf->beginWrite(), n);
+    buf->hasWritten(n);
+    readPos_ = head + n;
+    in.head.store(readPos_, std::memory_order_release);
+
+    // 与write中的检查配对: 写入方要么看到这次取走的位置,要么由这里看到它新写入的数据
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(in.writerWaiting.load(std::memory_order_relaxed) && in.writerWaiting.exchange(0)){
+        ring(peerDoorbellFd_);
+    }
+    // 受读预算限制没读完的,或读的同时新写入的数据,写入方不会再通知
+    if(in.tail.load(std::memory_order_acquire) != head + n){
+        ring();
+    }
+    return static_cast<ssize_t>(n);
+}
+
+ssize_t ShmTransport::write(const struct iovec *iov, int iovcnt){
+    ShmRing &out = control_->rings[side_];
+    if(protocolError_ || out.closed.load(std::memory_order_relaxed) || !control_->alive[1 - side_].load(std::memory_order_acquire)){
+        errno = EPIPE;
+        return -1;
+    }
+    size_t total = 0;
+    for(int i = 0; i < iovcnt; ++i){
+        total += iov[i].iov_len;
+    }
+    if(total == 0){
+        return 0;
+    }
+    // tail由本端维护; 对端写入的head须在[tail - capacity_, tail]之内
+    uint64_t tail = writePos_;
+    uint64_t head = out.head.load(std::memory_order_acquire);
+    if(tail - head > capacity_){
+        setProtocolError(head, tail);
+        errno = EPIPE;
+        return -1;
+    }
+    size_t space = capacity_ - static_cast<size_t>(tail - head);
+    size_t written = 0;
+    for(int i = 0; i < iovcnt && written < space; ++i){
+        size_t n = std::min(iov[i].iov_len, space - written);
+        copyIn(ringData(side_), capacity_, tail + written, static_cast<const char *>(iov[i].iov_base), n);
+        written += n;
+    }
+    if(written > 0){
+        writePos_ = tail + written;
+        out.tail.store(writePos_, std::memory_order_release);
+        // 读取方已取空之前的数据,可能已经睡了
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(out.head.load(std::memory_order_relaxed) == tail){
+            ring(peerDoorbellFd_);
+        }
+    }
+    if(written < total){
+        // 先登记等待再检查一次,读取方要么看到登记,要么这里看到它腾出的空间
+        out.writerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(writePos_ - out.head.load(std::memory_order_acquire) != capacity_){
+            ring();
+        }
+    }
+    if(written == 0){
+        errno = EWOULDBLOCK;
+        return -1;
+    }
+    return static_cast<ssize_t>(written);
+}
+
+void ShmTransport::shutdownWrite(){
+    control_->rings[side_].closed.store(1, std::memory_order_release);
+    ring(peerDoorbellFd_);
+}
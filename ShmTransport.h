@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Transport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class InetAddress;
+struct ShmControl;
+
+/**
+ * 同一台机器上进程间的共享内存连接: 一块memfd共享内存中每个方向一个单生产者单消费者的字节环,
+ * 两端各有一个eventfd门铃. 数据只在两个进程的地址空间之间拷贝,不经过内核的socket缓冲区
+ *
+ * 客户端用connect创建共享内存与两个门铃,通过Unix域socket(SCM_RIGHTS)交给服务端的ShmListener,
+ * 握手完成后Unix socket即关闭. 两端的Transport分别交给TcpClient::connect(TransportPtr)与
+ * TcpServer::acceptTransport,使用者的MessageCallback不用修改
+ *
+ * 写入方只在环由空变为非空时敲对端的门铃,读取方只在写入方等待空间时敲回去,
+ * 持续收发时多数读写不需要系统调用. 一端关闭或析构时标记在共享内存中;
+ * 对端进程崩溃没有机会标记,连接不会自动关闭,需要上层的心跳或超时
+ */
+class ShmTransport : public Transport{
+public:
+    static const size_t kDefaultCapacity = 1024 * 1024;
+
+    // 连接listenAddr上的ShmListener,阻塞到服务端确认. capacity为每个方向的字节数,向上取整为2的幂
+    // 失败时返回空
+    static TransportPtr connect(const InetAddress &listenAddr, size_t capacity = kDefaultCapacity);
+    // 从已连接的Unix socket收取握手消息并回复确认,不关闭sockfd. 消息还没到时返回空且*wouldBlock为true
+    static TransportPtr accept(int sockfd, bool *wouldBlock);
+
+    ~ShmTransport() override;
+
+    bool readable() const override;
+    bool writable() const override;
+    ssize_t read(Buffer *buf, size_t maxBytes, int *savedErrno) override;
+    ssize_t write(const struct iovec *iov, int iovcnt) override;
+    void shutdownWrite() override;
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    // 客户端为side 0,服务端为side 1; 接管两个门铃fd的所有权,本端的由TcpConnection关闭
+    // capacity为握手时校验过的值,不再读取共享内存中的那一份
+    ShmTransport(void *base, size_t mappedSize, size_t capacity, int side, int doorbellFd, int peerDoorbellFd);
+
+    char *ringData(int side) const;
+    void setProtocolError(uint64_t head, uint64_t tail);
+
+    ShmControl *control_;
+    size_t mappedSize_;
+    size_t capacity_;
+    const int side_;
+    const int peerDoorbellFd_;
+    // 共享内存可被对端任意改写,本端维护的位置只以本地副本为准
+    uint64_t readPos_;  // 输入环的head
+    uint64_t writePos_; // 输出环的tail
+    bool protocolError_;
+};
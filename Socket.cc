@@ -3,6 +3,7 @@
 #include "InetAddress.h"
 
 #include <unistd.h>
+#include <errno.h>
 #include <arpa/inet.h>
 #include <strings.h>
 #include <sys/types.h>
@@ -14,7 +15,7 @@ Socket::~Socket(){
 }
 
 void Socket::bindAddress(const InetAddress &localaddr){
-    if (0 != ::bind(sockfd_, (sockaddr *)localaddr.getSockAddr(), sizeof(sockaddr_in))){
+    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), localaddr.getSockLen())){
         LOG_FATAL("bind sockfd:%d fail \n", sockfd_);
     }
 }
@@ -26,12 +27,12 @@ void Socket::listen(){
 }
 
 int Socket::accept(InetAddress *peeraddr){ // peeraddr为传出参数,存储客户端的ip+port
-    sockaddr_in addr;
+    sockaddr_storage addr; // 可能是IPv4或Unix域地址
     socklen_t len = sizeof(addr);
     bzero(&addr, sizeof(addr));
     int connfd = ::accept4(sockfd_, (sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0){
-        peeraddr->setSockAddr(addr);
+        peeraddr->setSockAddr((sockaddr *)&addr, len);
     }
     return connfd;
 }
@@ -57,4 +58,15 @@ void Socket::setReusePort(bool on){
 void Socket::setKeepAlive(bool on){
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
-}
\ No newline at end of file
+}
+void Socket::setBusyPoll(int usec, bool prefer){
+    if(::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0){
+        LOG_ERROR("setsockopt SO_BUSY_POLL error:%d \n", errno);
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    int optval = prefer ? 1 : 0;
+    if(::setsockopt(sockfd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &optval, sizeof(optval)) < 0){
+        LOG_ERROR("setsockopt SO_PREFER_BUSY_POLL error:%d \n", errno);
+    }
+#endif
+}
@@ -23,6 +23,8 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // 内核在读该socket时忙轮询网卡队列usec微秒;prefer为true时优先忙轮询而非软中断(需内核5.11+)
+    void setBusyPoll(int usec, bool prefer);
 
 private:
     const int sockfd_;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+#include <stddef.h>
+
+/**
+ * 有界的单生产者单消费者环形队列: 只有一个线程push,只有一个线程consume,全程无锁
+ * 容量向上取整为2的幂; head_与tail_各占一个缓存行,双方各自缓存对方的下标,
+ * 只有在看起来满/空时才去读对方的原子变量,减少缓存行在两个核之间来回传递
+ */
+template <typename T>
+class SpscRing : noncopyable{
+public:
+    explicit SpscRing(size_t capacity)
+        : mask_(roundUp(capacity) - 1)
+        , slots_(static_cast<T *>(::operator new(sizeof(T) * (mask_ + 1))))
+        , head_(0)
+        , cachedTail_(0)
+        , tail_(0)
+        , cachedHead_(0)
+    {
+    }
+
+    ~SpscRing(){
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for(; head != tail; ++head){
+            slots_[head & mask_].~T();
+        }
+        ::operator delete(slots_);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 生产者线程调用,队列满时返回false,value保持不变
+    template <typename U>
+    bool push(U &&value){
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if(tail - cachedHead_ > mask_){
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if(tail - cachedHead_ > mask_){
+                return false;
+            }
+        }
+        new (&slots_[tail & mask_]) T(std::forward<U>(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者线程调用: 对最多max个元素依次调用f(T &),返回取出的个数. 一批只发布一次head_
+    template <typename F>
+    size_t consume(F &&f, size_t max){
+        size_t head = head_.load(std::memory_order_relaxed);
+        if(cachedTail_ == head){
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+        }
+        size_t n = cachedTail_ - head;
+        if(n > max){
+            n = max;
+        }
+        for(size_t i = 0; i < n; ++i){
+            T &slot = slots_[(head + i) & mask_];
+            f(slot);
+            slot.~T();
+        }
+        if(n > 0){
+            head_.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // 近似值,只用于统计
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+private:
+    static const size_t kCacheLine = 64;
+
+    static size_t roundUp(size_t n){
+        size_t capacity = 2;
+        while(capacity < n){
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    const size_t mask_;
+    T *const slots_;
+    alignas(kCacheLine) std::atomic<size_t> head_; // 消费者写
+    size_t cachedTail_;                             // 消费者缓存的tail_
+    alignas(kCacheLine) std::atomic<size_t> tail_; // 生产者写
+    size_t cachedHead_;                             // 生产者缓存的head_
+};
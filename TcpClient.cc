@@ -0,0 +1,148 @@
+#include "TcpClient.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+#include <sys/socket.h>
+#include <strings.h>
+#include <stdio.h>
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop){
+    if(loop == nullptr){
+        LOG_FATAL("%s:%s:%d TcpClient loop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+// TcpClient析构后,连接关闭时只需销毁连接
+static void destroyConnection(EventLoop *loop, const TcpConnectionPtr &conn){
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+static void defaultConnectionCallback(const TcpConnectionPtr &conn){
+    LOG_INFO("TcpClient connection %s -> %s is %s \n", conn->localAddress().toIpPort().c_str(),
+             conn->peerAddress().toIpPort().c_str(), conn->connected() ? "UP" : "DOWN");
+}
+
+static void defaultMessageCallback(const TcpConnectionPtr &, Buffer *buf, Timestamp){
+    buf->retrieveAll();
+}
+
+TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , connector_(new Connector(loop, serverAddr))
+    , name_(nameArg)
+    , connectionCallback_(defaultConnectionCallback)
+    , messageCallback_(defaultMessageCallback)
+    , retry_(false)
+    , connect_(false)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_INFO("TcpClient::TcpClient[%s] - connector %p \n", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient(){
+    LOG_INFO("TcpClient::~TcpClient[%s] - connector %p \n", name_.c_str(), connector_.get());
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        unique = connection_.use_count() == 1;
+        conn = connection_;
+    }
+    if(conn){
+        // 连接可能比TcpClient活得久,关闭回调不能再访问this
+        CloseCallback cb = std::bind(&destroyConnection, loop_, std::placeholders::_1);
+        loop_->runInLoop(std::bind(&TcpConnection::setCloseCallback, conn, cb));
+        if(unique){
+            conn->forceClose();
+        }
+    }
+    else{
+        connector_->stop();
+    }
+}
+
+void TcpClient::connect(){
+    LOG_INFO("TcpClient::connect[%s] - connecting to %s \n", name_.c_str(),
+             connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::connect(TransportPtr transport){
+    connect_ = true;
+    // std::function要求可复制,用shared_ptr持有; 回调没有执行就被丢弃时transport随之释放
+    std::shared_ptr<TransportPtr> holder = std::make_shared<TransportPtr>(std::move(transport));
+    loop_->runInLoop([this, holder](){
+        int fd = (*holder)->fd();
+        establish(fd, InetAddress(), std::move(*holder));
+    });
+}
+
+void TcpClient::disconnect(){
+    connect_ = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(connection_){
+        connection_->shutdown();
+    }
+}
+
+void TcpClient::stop(){
+    connect_ = false;
+    connector_->stop();
+}
+
+// Connector连接成功后在loop_线程中执行,与TcpServer::newConnection相同地打包TcpConnection
+void TcpClient::newConnection(int sockfd){
+    sockaddr_storage local;
+    bzero(&local, sizeof(local));
+    socklen_t addrlen = sizeof(local);
+    if(::getsockname(sockfd, (sockaddr *)&local, &addrlen) < 0){
+        LOG_ERROR("sockets::getLocalAddr");
+    }
+    InetAddress localAddr((sockaddr *)&local, addrlen);
+    establish(sockfd, localAddr, TransportPtr());
+}
+
+// 在loop_线程中执行, transport为空时直接读写sockfd
+void TcpClient::establish(int sockfd, const InetAddress &localAddr, TransportPtr transport){
+    // Unix域socket的getpeername对端可能没有路径,直接用连接的目标地址
+    const InetAddress &peerAddr = connector_->serverAddress();
+
+    char buf[64] = {0};
+    snprintf(buf, sizeof(buf), ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+    ++nextConnId_;
+    std::string connName = name_ + buf;
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, localAddr, peerAddr));
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCloseCallback(std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    if(transport){
+        conn->setTransport(std::move(transport));
+    }
+    if(tlsContext_){
+        conn->startTls(tlsContext_, tlsHostName_);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->ConnectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn){
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if(retry_ && connect_ && !conn->transport()){
+        LOG_INFO("TcpClient::removeConnection[%s] - reconnecting to %s \n", name_.c_str(),
+                 connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Connector;
+class EventLoop;
+
+using ConnectorPtr = std::shared_ptr<Connector>;
+
+/**
+ * 对外的客户端编程使用的类
+ * Connector建立连接后,和TcpServer一样把sockfd打包成TcpConnection,交给loop_管理
+ */
+class TcpClient : noncopyable {
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();
+    // 不经过Connector,直接在transport上建立连接(如LoopbackTransport的一端),断开后不重连
+    void connect(TransportPtr transport);
+    void disconnect(); // 半关闭,等待待发送数据发完
+    void stop();       // 停止连接中的Connector
+
+    TcpConnectionPtr connection() const{
+        std::unique_lock<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop *getLoop() const { return loop_; }
+    const std::string &name() const { return name_; }
+
+    // 连接建立后断开时自动重连
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }
+
+    // 需在connect之前设置
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    // 使用TLS连接服务端, context需为TlsContext::kClient模式. 重连时恢复上一次的会话
+    // hostName为服务端的域名或IP,通过SNI发送,context->setVerifyPeer时按它校验证书
+    void setTlsContext(const TlsContextPtr &context, const std::string &hostName = std::string())
+    { tlsContext_ = context; tlsHostName_ = hostName; }
+
+private:
+    void newConnection(int sockfd);
+    void establish(int sockfd, const InetAddress &localAddr, TransportPtr transport);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    TlsContextPtr tlsContext_; // 为空时不使用TLS
+    std::string tlsHostName_;
+
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int nextConnId_; // 只在loop_线程访问
+
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_; // 受mutex_保护
+};
@@ -3,6 +3,9 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "TlsSession.h"
+#include "Tracer.h"
+#include "TrafficRecorder.h"
 
 #include <functional>
 #include <errno.h>
@@ -13,6 +16,9 @@
 #include <sys/socket.h>
 #include <netinet/tcp.h>
 #include <string>
+#include <algorithm>
+#include <limits.h>
+#include <sys/uio.h>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -23,32 +29,85 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
     return loop;
 }
 
+// 所有连接默认共享的空回调
+static const ConnectionCallbacksPtr &emptyCallbacks(){
+    static const ConnectionCallbacksPtr callbacks = std::make_shared<ConnectionCallbacks>();
+    return callbacks;
+}
+
 TcpConnection::TcpConnection(EventLoop *loop,
                            const std::string &nameArg,
                            int sockfd,
                            const InetAddress &localAddr,
                            const InetAddress &peerAddr)
+    : TcpConnection(loop, std::make_shared<const std::string>(nameArg), 0, sockfd, localAddr, peerAddr)
+{}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                           const std::shared_ptr<const std::string> &namePrefix,
+                           int64_t id,
+                           int sockfd,
+                           const InetAddress &localAddr,
+                           const InetAddress &peerAddr)
     : loop_(CheckLoopNotNull(loop))
-    , name_(nameArg)
+    , namePrefix_(namePrefix)
+    , id_(id)
     , state_(kConnecting)
     , reading_(true)
-    , socket_(new Socket(sockfd))
-    , channel_(new Channel(loop,sockfd))
+    , announced_(false)
+    , socket_(sockfd)
+    , channel_(loop, sockfd)
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
+    , callbacks_(emptyCallbacks())
     , highWaterMark_(64*1024*1024) // 64M
+    , lowWaterMark_(0)
+    , flowControl_(false)
+    , pausedByFlowControl_(false)
+    , readBudget_(0)
+    , corking_(false)
+    , corked_(false)
+    , transportWriting_(false)
+    , outputCounter_(nullptr)
+    , outputBytes_(0)
+    , highWaterSince_(0)
+    , captureId_(0)
+    , inputBuffer_(0) // 空闲连接不预先占用缓冲区,第一次读写时再按需增长
+    , outputBuffer_(0)
+    , pendingSliceBytes_(0)
 {
-    channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-    channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
+    setupChannel();
+    LOG_INFO("TcpConnection::ctor[%s] at fd=%d \n", name().c_str(), sockfd);
+    socket_.setKeepAlive(true);
+}
+
+// 只捕获this的lambda可以存放在std::function内部,不像std::bind那样需要额外分配
+void TcpConnection::setupChannel(){
+    channel_.setReadCallback([this](Timestamp receiveTime){ handleRead(receiveTime); });
+    channel_.setWriteCallback([this](){ handleWrite(); });
+    channel_.setCloseCallback([this](){ handleClose(); });
+    channel_.setErrorCallback([this](){ handleError(); });
+}
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d \n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+std::string TcpConnection::name() const{
+    if(id_ == 0){
+        return *namePrefix_;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "#%ld", (long)id_);
+    return *namePrefix_ + buf;
+}
+
+// 共享的回调不能原地修改,先复制一份归本连接独有
+ConnectionCallbacks *TcpConnection::mutableCallbacks(){
+    if(callbacks_.use_count() != 1){
+        callbacks_ = std::make_shared<ConnectionCallbacks>(*callbacks_);
+    }
+    return callbacks_.get();
 }
 
 TcpConnection::~TcpConnection(){
-    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n", name_.c_str(), channel_->fd(), (int)state_);
+    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n", name().c_str(), channel_.fd(), (int)state_);
 }
 
 // 发送数据到客户端
@@ -58,12 +117,103 @@ void TcpConnection::send(const std::string &buf){
             sendInLoop(buf.c_str(), buf.size());
         }
         else{
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            // 跨线程发送时拷贝一份数据,调用方的buf可能在sendInLoop执行前就已经释放
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer *buf){
+    if(state_ == kConnected){
+        if(loop_->isInLoopThread()){
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else{
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf->retrieveAllAsString()));
+        }
+    }
+}
+
+// 拼接成一份拷贝,供跨线程发送
+static std::string concatenate(const struct iovec *iov, int iovcnt){
+    size_t total = 0;
+    for(int i = 0; i < iovcnt; ++i){
+        total += iov[i].iov_len;
+    }
+    std::string result;
+    result.reserve(total);
+    for(int i = 0; i < iovcnt; ++i){
+        result.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+    }
+    return result;
+}
+
+void TcpConnection::send(const struct iovec *iov, int iovcnt){
+    if(state_ == kConnected){
+        if(loop_->isInLoopThread()){
+            sendInLoop(iov, iovcnt);
+        }
+        else{
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), concatenate(iov, iovcnt)));
+        }
+    }
+}
+
+void TcpConnection::send(const ScatterMessage &message){
+    if(state_ == kConnected){
+        if(loop_->isInLoopThread()){
+            sendInLoop(message.iov(), message.iovcnt(), message.slices());
+        }
+        else if(message.borrowsMemory()){
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(),
+                                       concatenate(message.iov(), message.iovcnt())));
+        }
+        else{
+            // 数据块全部由引用计数持有,复制消息只增加引用计数
+            loop_->runInLoop(std::bind(&TcpConnection::sendMessageInLoop, shared_from_this(), message));
+        }
+    }
+}
+
+void TcpConnection::send(const ScatterMessage::Slice &payload){
+    if(state_ == kConnected && payload && !payload->empty()){
+        if(loop_->isInLoopThread()){
+            sendSliceInLoop(payload);
+        }
+        else{
+            loop_->runInLoop(std::bind(&TcpConnection::sendSliceInLoop, shared_from_this(), payload));
         }
     }
 }
 
+void TcpConnection::sendSliceInLoop(const ScatterMessage::Slice &payload){
+    struct iovec iov;
+    iov.iov_base = const_cast<char *>(payload->data());
+    iov.iov_len = payload->size();
+    sendInLoop(&iov, 1, &payload);
+}
+
+void TcpConnection::sendStringInLoop(const std::string &message){
+    sendInLoop(message.data(), message.size());
+}
+
+void TcpConnection::sendMessageInLoop(const ScatterMessage &message){
+    sendInLoop(message.iov(), message.iovcnt(), message.slices());
+}
+
 void TcpConnection::sendInLoop(const void *data, size_t len){
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(data);
+    iov.iov_len = len;
+    sendInLoop(&iov, 1);
+}
+
+void TcpConnection::sendInLoop(const struct iovec *iov, int iovcnt, const ScatterMessage::Slice *slices){
+    size_t len = 0;
+    for(int i = 0; i < iovcnt; ++i){
+        len += iov[i].iov_len;
+    }
     ssize_t nwrote = 0;
     ssize_t remaining = len;
     bool faultError = false;
@@ -71,16 +221,39 @@ void TcpConnection::sendInLoop(const void *data, size_t len){
         LOG_ERROR("disconnected, give up writing!");
         return;
     }
+    if(captureId_){
+        TrafficRecorder::outbound(captureId_, iov, iovcnt);
+    }
+    if(tls_){
+        sendTlsInLoop(iov, iovcnt);
+        return;
+    }
+    if(corking_ && !isWriting()){
+        // 事件处理期间的小块数据先攒着,本轮事件处理完后由flushCorked一次写出
+        if(loop_->eventHandling() && outputBuffer_.readableBytes() + len < kMaxCorkBytes){
+            for(int i = 0; i < iovcnt; ++i){
+                outputBuffer_.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+            }
+            updateOutputBytes();
+            if(!corked_){
+                corked_ = true;
+                loop_->runAfterEvents(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+            }
+            return;
+        }
+        // 大块数据: 先把攒着的数据发出去,再走下面的直接发送
+        flushCorked();
+    }
     // 当前Channel未注册可写事件监听,说明此时内核发送缓冲区可能未满; outputBuffer_没有待发送数据
     // 这说明fd的内核写缓冲区可能未满,可以尝试直接往里发送数据
-    if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0){
-        nwrote = ::write(channel_->fd(), data, len);
+    if(!isWriting() && outputBuffer_.readableBytes() == 0){
+        nwrote = writeOutput(iov, iovcnt);
         if(nwrote >= 0){
             // 剩余未发送的数据长度
             remaining = len - nwrote;
-            if(remaining == 0 && writeCompleteCallback_){
+            if(remaining == 0 && callbacks_->writeCompleteCallback){
                 // 既然在这里数据全部发送完成,就不用再给channel设置epollout事件了,不会再执行handleWrite
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
                 // 如果在这里没发完,说明fd写缓冲区满了,那就注册epollout事件,等待可写
             }
         }
@@ -97,18 +270,273 @@ void TcpConnection::sendInLoop(const void *data, size_t len){
     // poller会监听,当发现fd的写缓冲区有空间后会通知相应的channel,调用writeCallback_回调方法
     // 也就是调用TcpConnection::handleWrite方法,把outputBuffer_继续写入fd的写缓冲区
     if(!faultError && remaining > 0){
-        size_t oldLen = outputBuffer_.readableBytes();
+        size_t oldLen = pendingBytes();
         // oldLen : outputBuffer_中目前剩余的待发送的数据长度
         // remaining : 参数data还没有发完的数据长度, 需要把这段数据保存到outputBuffer_中
-        if(oldLen + remaining >= highWaterMark_ 
-            && oldLen < highWaterMark_
-            && highWaterMarkCallback_)
-        {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+        outputBufferGrew(oldLen, oldLen + remaining);
+        // 只保存没写进内核的尾部: 跳过已写完的块,从写了一部分的块的剩余处开始
+        size_t skip = nwrote > 0 ? nwrote : 0;
+        for(int i = 0; i < iovcnt; ++i){
+            if(skip >= iov[i].iov_len){
+                skip -= iov[i].iov_len;
+                continue;
+            }
+            appendPending(static_cast<const char *>(iov[i].iov_base) + skip, iov[i].iov_len - skip,
+                          slices ? &slices[i] : nullptr);
+            skip = 0;
+        }
+        updateOutputBytes();
+        if(!isWriting()){
+            enableWriting();
+        }
+    }
+    if(trace_ && nwrote > 0){
+        traceWritten();
+    }
+}
+
+// 引用计数的数据块只记录引用;其余数据在没有排队的数据块时拷贝进outputBuffer_,
+// 否则拷贝一份排在数据块后面
+void TcpConnection::appendPending(const char *data, size_t len, const ScatterMessage::Slice *slice){
+    if(slice && *slice){
+        pendingSlices_.push_back(PendingSlice{*slice, static_cast<size_t>(data - (*slice)->data())});
+        pendingSliceBytes_ += len;
+    }
+    else if(pendingSlices_.empty()){
+        outputBuffer_.append(data, len);
+    }
+    else{
+        pendingSlices_.push_back(PendingSlice{std::make_shared<const std::string>(data, len), 0});
+        pendingSliceBytes_ += len;
+    }
+}
+
+// 用一次writev发送outputBuffer_和排队的数据块
+ssize_t TcpConnection::writePending(int *savedErrno){
+    static const int kMaxIovecs = 64;
+    struct iovec iov[kMaxIovecs];
+    int iovcnt = 0;
+    if(outputBuffer_.readableBytes() > 0){
+        iov[iovcnt].iov_base = const_cast<char *>(outputBuffer_.peek());
+        iov[iovcnt].iov_len = outputBuffer_.readableBytes();
+        ++iovcnt;
+    }
+    for(auto it = pendingSlices_.begin(); it != pendingSlices_.end() && iovcnt < kMaxIovecs; ++it){
+        iov[iovcnt].iov_base = const_cast<char *>(it->data->data()) + it->offset;
+        iov[iovcnt].iov_len = it->data->size() - it->offset;
+        ++iovcnt;
+    }
+    ssize_t n = writeOutput(iov, iovcnt);
+    if(n < 0){
+        *savedErrno = errno;
+    }
+    return n;
+}
+
+// 已发送len字节: 先从outputBuffer_中取出,再从排队的数据块中取出
+void TcpConnection::retrievePending(size_t len){
+    size_t fromBuffer = std::min(len, outputBuffer_.readableBytes());
+    outputBuffer_.retrieve(fromBuffer);
+    len -= fromBuffer;
+    while(len > 0){
+        PendingSlice &front = pendingSlices_.front();
+        size_t left = front.data->size() - front.offset;
+        if(len < left){
+            front.offset += len;
+            pendingSliceBytes_ -= len;
+            break;
+        }
+        len -= left;
+        pendingSliceBytes_ -= left;
+        pendingSlices_.pop_front();
+    }
+}
+
+// outputBuffer_中待发送数据由oldLen增长到newLen: 高水位回调、流控与高水位计时
+void TcpConnection::outputBufferGrew(size_t oldLen, size_t newLen){
+    if(newLen >= highWaterMark_ && oldLen < highWaterMark_ && callbacks_->highWaterMarkCallback){
+        loop_->queueInLoop(std::bind(callbacks_->highWaterMarkCallback, shared_from_this(), newLen));
+    }
+    // 对端不读取响应却持续发送请求时,暂停读取它的请求,让outputBuffer_不再无限增长
+    if(flowControl_ && newLen >= highWaterMark_ && reading_){
+        stopReadInLoop();
+        pausedByFlowControl_ = true;
+    }
+    if(newLen >= highWaterMark_ && oldLen < highWaterMark_){
+        highWaterSince_.store(loop_->pollReturnTime().microSecondsSinceEpoch(), std::memory_order_relaxed);
+    }
+}
+
+// 把写合并攒下的数据一次写出,没写完的部分照常交给handleWrite
+void TcpConnection::flushCorked(){
+    if(!corked_){
+        return;
+    }
+    corked_ = false;
+    if(!isWriting()){
+        flushOutput(0);
+    }
+}
+
+// 把直接追加到outputBuffer_的数据(攒下的数据或TLS记录)写出, oldLen为追加之前的长度
+void TcpConnection::flushOutput(size_t oldLen){
+    if(state_ == kDisconnected || outputBuffer_.readableBytes() == 0){
+        return;
+    }
+    if(isWriting()){ // 由handleWrite接着发送
+        outputBufferGrew(oldLen, pendingBytes());
+        updateOutputBytes();
+        return;
+    }
+    struct iovec iov;
+    iov.iov_base = const_cast<char *>(outputBuffer_.peek());
+    iov.iov_len = outputBuffer_.readableBytes();
+    ssize_t n = writeOutput(&iov, 1);
+    if(n > 0){
+        outputBuffer_.retrieve(n);
+        updateOutputBytes();
+        if(trace_){
+            traceWritten();
+        }
+    }
+    else if(n < 0 && errno != EWOULDBLOCK){
+        LOG_ERROR("TcpConnection::flushOutput");
+        if(errno == EPIPE || errno == ECONNRESET){
+            return;
+        }
+    }
+    if(outputBuffer_.readableBytes() == 0){
+        if(callbacks_->writeCompleteCallback && announced_){
+            loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
         }
-        outputBuffer_.append((char *)data + nwrote, remaining);
-        if(!channel_->isWriting()){
-            channel_->enableWriting();
+        if(state_ == kDisconnecting){
+            shutdownInLoop();
+        }
+    }
+    else{
+        outputBufferGrew(oldLen, outputBuffer_.readableBytes());
+        updateOutputBytes();
+        enableWriting();
+    }
+}
+
+void TcpConnection::startTls(const TlsContextPtr &context, const std::string &hostName){
+    // 客户端按服务端地址缓存会话
+    tls_.reset(new TlsSession(context, &outputBuffer_, context->isServer() ? std::string() : peerAddr_.toIpPort(),
+                              hostName));
+}
+
+void TcpConnection::setTransport(TransportPtr transport){
+    transport_ = std::move(transport);
+    channel_.setReadCallback([this](Timestamp receiveTime){ handleDoorbell(receiveTime); });
+}
+
+ssize_t TcpConnection::readInput(Buffer *buf, int *savedErrno){
+    return transport_ ? transport_->read(buf, readBudget_, savedErrno)
+                      : buf->readFd(channel_.fd(), savedErrno, readBudget_);
+}
+
+// 与write/writev相同,失败时设置errno
+ssize_t TcpConnection::writeOutput(const struct iovec *iov, int iovcnt){
+    if(transport_){
+        return transport_->write(iov, iovcnt);
+    }
+    return iovcnt == 1 ? ::write(channel_.fd(), iov[0].iov_base, iov[0].iov_len)
+                       : ::writev(channel_.fd(), iov, std::min(iovcnt, IOV_MAX));
+}
+
+void TcpConnection::enableWriting(){
+    if(transport_){
+        transportWriting_ = true;
+    }
+    else{
+        channel_.enableWriting();
+    }
+}
+
+void TcpConnection::disableWriting(){
+    if(transport_){
+        transportWriting_ = false;
+    }
+    else{
+        channel_.disableWriting();
+    }
+}
+
+// 明文逐块加密后追加到outputBuffer_,再整体写出. 写合并时同样攒到本轮事件处理完
+void TcpConnection::sendTlsInLoop(const struct iovec *iov, int iovcnt){
+    size_t oldLen = outputBuffer_.readableBytes();
+    for(int i = 0; i < iovcnt; ++i){
+        if(!tls_->send(iov[i].iov_base, iov[i].iov_len)){
+            LOG_ERROR("TcpConnection::sendTlsInLoop [%s] - TLS error \n", name().c_str());
+            forceClose();
+            return;
+        }
+    }
+    if(corking_ && !isWriting() && loop_->eventHandling()
+        && outputBuffer_.readableBytes() < kMaxCorkBytes){
+        updateOutputBytes();
+        if(!corked_){
+            corked_ = true;
+            loop_->runAfterEvents(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+        }
+        return;
+    }
+    flushOutput(oldLen);
+}
+
+void TcpConnection::setTcpNoDelay(bool on){
+    socket_.setTcpNoDelay(on);
+}
+
+void TcpConnection::setBusyPoll(int usec, bool prefer){
+    socket_.setBusyPoll(usec, prefer);
+}
+
+void TcpConnection::startRead(){
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
+}
+
+void TcpConnection::startReadInLoop(){
+    if(state_ == kDisconnected){ // channel可能已从poller中移除,不能再注册事件
+        return;
+    }
+    pausedByFlowControl_ = false;
+    if(!reading_ || !channel_.isReading()){
+        channel_.enableReading();
+        reading_ = true;
+        if(transport_){ // 暂停期间到达的数据不会再有新的通知
+            transport_->ring();
+        }
+    }
+}
+
+void TcpConnection::stopRead(){
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
+}
+
+void TcpConnection::stopReadInLoop(){
+    if(state_ == kDisconnected){
+        return;
+    }
+    pausedByFlowControl_ = false;
+    if(reading_ || channel_.isReading()){
+        // Transport的门铃还要通知发送空间,不能取消监听
+        if(!transport_){
+            channel_.disableReading();
+        }
+        reading_ = false;
+    }
+}
+
+// outputBuffer_大小变化后调用,把变化量计入loop的计数器
+void TcpConnection::updateOutputBytes(){
+    size_t bytes = pendingBytes();
+    size_t old = outputBytes_.load(std::memory_order_relaxed);
+    if(bytes != old){
+        outputBytes_.store(bytes, std::memory_order_relaxed);
+        if(outputCounter_){
+            outputCounter_->add(static_cast<int64_t>(bytes) - static_cast<int64_t>(old));
         }
     }
 }
@@ -116,20 +544,44 @@ void TcpConnection::sendInLoop(const void *data, size_t len){
 // 连接建立
 void TcpConnection::ConnectEstablished(){
     setState(kConnected);
-    channel_->tie(shared_from_this());
-    channel_->enableReading(); // 向poller注册channel的读事件
+    if(TrafficRecorder::recording()){
+        captureId_ = TrafficRecorder::open(peerAddr_);
+    }
+    channel_.tie(shared_from_this());
+    channel_.enableReading(); // 向poller注册channel的读事件
 
+    if(tls_){
+        // 客户端发出ClientHello,握手完成后再执行连接建立的回调
+        bool ok = tls_->start();
+        flushOutput(0);
+        if(!ok){
+            handleClose();
+        }
+        return;
+    }
     // 新连接建立,执行回调
-    connectionCallback_(shared_from_this());
+    announced_ = true;
+    callbacks_->connectionCallback(shared_from_this());
 }
 // 连接销毁
 void TcpConnection::connectDestroyed(){
     if(state_ == kConnected){
         setState(kDisconnected);
-        channel_->disableAll(); // 把channel所有感兴趣的事件从poller中del
-        connectionCallback_(shared_from_this());
+        channel_.disableAll(); // 把channel所有感兴趣的事件从poller中del
+        if(announced_){
+            callbacks_->connectionCallback(shared_from_this());
+        }
+    }
+    channel_.remove(); // 把channel从poller中del
+    if(captureId_){
+        TrafficRecorder::close(captureId_);
+        captureId_ = 0;
     }
-    channel_->remove(); // 把channel从poller中del
+    // 未发送的数据不再占用预算
+    outputBuffer_.retrieveAll();
+    pendingSlices_.clear();
+    pendingSliceBytes_ = 0;
+    updateOutputBytes();
 }
 
 void TcpConnection::shutdown(){
@@ -140,21 +592,105 @@ void TcpConnection::shutdown(){
 }
 
 void TcpConnection::shutdownInLoop(){
-    if(!channel_->isWriting()){ // 说明outputBuffer_中的数据已经全部发送完成
+    if(tls_ && !tls_->established()){
+        // 握手还没完成,暂存的明文与close_notify在握手完成后发出,随后flushOutput/handleWrite再进入这里关闭写端
+        tls_->shutdown();
+        return;
+    }
+    if(tls_ && !tls_->closeNotifySent()){
+        // 先发出close_notify,它发送完后会再次进入这里关闭写端
+        size_t oldLen = outputBuffer_.readableBytes();
+        tls_->shutdown();
+        if(outputBuffer_.readableBytes() > oldLen){
+            if(!corked_){
+                flushOutput(oldLen);
+            }
+            return;
+        }
+    }
+    // 攒着的数据由flushCorked发送完后再关闭写端
+    if(!isWriting() && !corked_){ // 说明outputBuffer_中的数据已经全部发送完成
         // 关闭写端,触发channel的EPOLLHUP,则channel调用closeCallback_回调,即TcpConnection::handleClose
-        socket_->shutdownWrite(); 
+        if(transport_){
+            transport_->shutdownWrite();
+        }
+        else{
+            socket_.shutdownWrite();
+        }
+    }
+}
+
+void TcpConnection::forceClose(){
+    if(state_ == kConnected || state_ == kDisconnecting){
+        setState(kDisconnecting);
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop(){
+    if(state_ == kConnected || state_ == kDisconnecting){
+        handleClose();
+    }
+}
+
+// 调用messageCallback,按采样率为这次到达的数据开始一个追踪span
+// 上一个span还没写完响应时不再采样,它会覆盖这次回调之后的发送; 超过Tracer::kMaxSpanAgeUs的丢弃
+// newBytes为inputBuffer_末尾新到的(明文)字节数,录制流量时记录下来
+void TcpConnection::deliverMessage(Timestamp receiveTime, size_t newBytes){
+    if(captureId_){
+        TrafficRecorder::inbound(captureId_, receiveTime,
+                                 inputBuffer_.peek() + inputBuffer_.readableBytes() - newBytes, newBytes);
+    }
+    // 回调不发送响应(或迟迟没有异步发送)时span不会结束,不能让它一直占着
+    if(trace_ && Timestamp::now().microSecondsSinceEpoch() - trace_->receiveUs > Tracer::kMaxSpanAgeUs){
+        trace_.reset();
+    }
+    if(Tracer::enabled() && !trace_ && Tracer::sample()){
+        trace_.reset(new TraceSpan{id_, receiveTime.microSecondsSinceEpoch(),
+                                   Timestamp::now().microSecondsSinceEpoch(), 0, 0, 0});
+    }
+    callbacks_->messageCallback(shared_from_this(), &inputBuffer_, receiveTime);
+    if(trace_ && trace_->callbackEndUs == 0){
+        trace_->callbackEndUs = Timestamp::now().microSecondsSinceEpoch();
+        if(trace_->doneUs > 0){
+            finishTrace();
+        }
+    }
+}
+
+// 一次发送系统调用写出了数据: 记录第一次发送的时刻,待发送数据清空时span结束
+void TcpConnection::traceWritten(){
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    if(trace_->sentUs == 0){
+        trace_->sentUs = now;
+    }
+    if(pendingBytes() == 0 && trace_->doneUs == 0){
+        trace_->doneUs = now;
+        // 回调中就写完了的,等回调返回后再记录
+        if(trace_->callbackEndUs > 0){
+            finishTrace();
+        }
     }
 }
 
+void TcpConnection::finishTrace(){
+    Tracer::record(*trace_);
+    trace_.reset();
+}
+
 // 接收客户端的数据
 // 监听channel->fd的读事件,当fd里有数据来了,则可读,调用此handleRead回调,把fd里的数据读到inputBuffer_
 // 然后触发messageCallback_
 // 也就是说,客户端发来的数据,channel的读回调仅负责把它读到inputBuffer_,对于发来的数据真正的处理是在messageCallback_
 void TcpConnection::handleRead(Timestamp receiveTime){
+    if(tls_){
+        handleTlsRead(receiveTime);
+        return;
+    }
     int saveErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &saveErrno);
+    ssize_t n = readInput(&inputBuffer_, &saveErrno);
     if(n > 0){
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        deliverMessage(receiveTime, n);
     }
     else if(n == 0){
         handleClose();
@@ -166,18 +702,76 @@ void TcpConnection::handleRead(Timestamp receiveTime){
     }
 }
 
+// 密文读进TlsSession,解密出的明文追加到inputBuffer_再交给messageCallback
+void TcpConnection::handleTlsRead(Timestamp receiveTime){
+    int saveErrno = 0;
+    ssize_t n = readInput(tls_->cipherInput(), &saveErrno);
+    if(n > 0){
+        bool wasEstablished = tls_->established();
+        size_t oldInput = inputBuffer_.readableBytes();
+        size_t oldOutput = outputBuffer_.readableBytes();
+        bool ok = tls_->receive(&inputBuffer_);
+        flushOutput(oldOutput); // 握手消息、告警以及握手期间暂存的数据
+        if(!ok){
+            LOG_ERROR("TcpConnection::handleTlsRead [%s] - TLS error \n", name().c_str());
+            handleClose();
+            return;
+        }
+        // 握手完成前就已shutdown的连接不再通知使用者
+        if(!wasEstablished && tls_->established() && state_ == kConnected){
+            announced_ = true;
+            callbacks_->connectionCallback(shared_from_this());
+        }
+        if(announced_ && inputBuffer_.readableBytes() > oldInput){
+            deliverMessage(receiveTime, inputBuffer_.readableBytes() - oldInput);
+        }
+    }
+    else if(n == 0){
+        handleClose();
+    }
+    else{
+        errno = saveErrno;
+        LOG_ERROR("TcpConnection::handleTlsRead");
+        handleError();
+    }
+}
+
+// Transport的门铃响了: 对端写入了数据、关闭了写端或腾出了发送空间,门铃不区分是哪一种,逐一检查
+void TcpConnection::handleDoorbell(Timestamp receiveTime){
+    transport_->clearDoorbell();
+    if(transportWriting_ && transport_->writable()){
+        handleWrite();
+    }
+    if(reading_ && state_ != kDisconnected && transport_->readable()){
+        handleRead(receiveTime);
+    }
+}
+
 // 监听channel->fd的写事件,当fd可写(即内核发送缓冲区有空间),把outputBuffer_里的数据写入到fd
 void TcpConnection::handleWrite(){
-    if(channel_->isWriting()){
+    if(isWriting()){
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno); // 将outputBuffer_中的数据写入内核发送缓冲区。
+        // 将outputBuffer_(以及排队的数据块)中的数据写入内核发送缓冲区。
+        ssize_t n = pendingSlices_.empty() && !transport_ ? outputBuffer_.writeFd(channel_.fd(), &savedErrno)
+                                                          : writePending(&savedErrno);
         if(n > 0){
-            outputBuffer_.retrieve(n);
-            if(outputBuffer_.readableBytes() == 0){
+            retrievePending(n);
+            updateOutputBytes();
+            if(trace_){
+                traceWritten();
+            }
+            if(pendingBytes() < highWaterMark_){
+                highWaterSince_.store(0, std::memory_order_relaxed);
+            }
+            // 因流控暂停读的连接,待发送数据回落到低水位以下后恢复读
+            if(pausedByFlowControl_ && pendingBytes() <= lowWaterMark_){
+                startReadInLoop();
+            }
+            if(pendingBytes() == 0){
                 // 如果写完之后outputBuffer_没有数据了,就不要再监听fd的的写事件了,否则一直监听它可写就要一直调用handleWrite,而又没东西可写
-                channel_->disableWriting(); 
-                if(writeCompleteCallback_){
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                disableWriting();
+                if(callbacks_->writeCompleteCallback && announced_){
+                    loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
                 }
             }
             if(state_ == kDisconnecting){
@@ -189,26 +783,28 @@ void TcpConnection::handleWrite(){
         }
     }
     else{
-        LOG_ERROR("TcpConnection fd=%d is down, no more writing \n", channel_->fd());
+        LOG_ERROR("TcpConnection fd=%d is down, no more writing \n", channel_.fd());
     }
 }
 void TcpConnection::handleClose(){
-    LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_->fd(), (int)state_);
+    LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_.fd(), (int)state_);
     setState(kDisconnected);
-    channel_->disableAll();
+    channel_.disableAll();
     TcpConnectionPtr connPtr(shared_from_this());
-    connectionCallback_(connPtr); // 执行连接关闭的回调
-    closeCallback_(connPtr); // 关闭连接的回调 执行的是TcpServer::removeConnection回调方法
+    if(announced_){
+        callbacks_->connectionCallback(connPtr); // 执行连接关闭的回调
+    }
+    callbacks_->closeCallback(connPtr); // 关闭连接的回调 执行的是TcpServer::removeConnection回调方法
 }
 void TcpConnection::handleError(){
     int optval;
     socklen_t optlen = sizeof(optval);
     int err = 0;
-    if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0){
+    if (::getsockopt(channel_.fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0){
         err = errno;
     }
     else{
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
+    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name().c_str(), err);
 }
\ No newline at end of file
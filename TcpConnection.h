@@ -5,14 +5,21 @@
 #include "Timestamp.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "OutputBudget.h"
+#include "ScatterMessage.h"
+#include "Socket.h"
+#include "Channel.h"
+#include "TlsContext.h"
+#include "Transport.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <deque>
 
-class Channel;
 class EventLoop;
-class Socket;
+class TlsSession;
+struct TraceSpan;
 
 /**
  * TcpServer => Acceptor => 有一个新用户连接,通过accept函数拿到connfd
@@ -26,31 +33,102 @@ public:
                   int sockfd,
                   const InetAddress &localAddr,
                   const InetAddress &peerAddr);
+    // 连接名为 namePrefix#id, 同一服务器的连接共享namePrefix,不必每个连接保存一份名字
+    TcpConnection(EventLoop *loop,
+                  const std::shared_ptr<const std::string> &namePrefix,
+                  int64_t id,
+                  int sockfd,
+                  const InetAddress &localAddr,
+                  const InetAddress &peerAddr);
     ~TcpConnection();
 
     EventLoop *getloop() const { return loop_; }
-    const std::string &name() const { return name_; }
+    std::string name() const;
+    int64_t id() const { return id_; }
     const InetAddress &localAddress() const { return localAddr_; }
     const InetAddress &peerAddress() const { return peerAddr_; }
 
     bool connected() const { return state_ == kConnected; }
 
+    // outputBuffer_中待发送字节数的快照,可在其他线程读取
+    size_t outputBytes() const { return outputBytes_.load(std::memory_order_relaxed); }
+    // outputBuffer_超过高水位的起始时间,未超过时为无效时间
+    Timestamp highWaterSince() const { return Timestamp(highWaterSince_.load(std::memory_order_relaxed)); }
+
     // 发送数据
     void send(const std::string &buf);
+    // 发送buf中的全部可读数据,发送后buf被清空
+    void send(Buffer *buf);
+    // 用writev发送多个不连续的数据块,在loop线程中调用时不拷贝已写进内核的部分
+    void send(const struct iovec *iov, int iovcnt);
+    void send(const ScatterMessage &message);
+    // 发送引用计数的不可变数据,跨线程时只增加引用计数,没写完的部分也只引用payload而不拷贝.
+    // 同一份payload可以同时发给任意多个连接,见BroadcastGroup
+    void send(const ScatterMessage::Slice &payload);
     // 关闭连接
     void shutdown();
     void shutdownInLoop();
+    // 不等待outputBuffer_发送完,直接关闭连接
+    void forceClose();
 
+    void setTcpNoDelay(bool on);
+    // 见Socket::setBusyPoll,配合EventLoop::setBusyPolling使用
+    void setBusyPoll(int usec, bool prefer);
+
+    // 只能在所属loop线程中访问
+    Buffer *inputBuffer() { return &inputBuffer_; }
+
+    // 上层协议保存在连接上的状态(如HTTP解析器),使用者自行static_pointer_cast
+    void setContext(const std::shared_ptr<void> &context) { context_ = context; }
+    const std::shared_ptr<void> &getContext() const { return context_; }
+
+    // 开始/停止监听读事件(在所属loop中切换EPOLLIN)
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    // 与其他连接共享一份回调;之后再调用下面的单个set函数时先复制一份再修改
+    void setCallbacks(const ConnectionCallbacksPtr &callbacks) { callbacks_ = callbacks; }
     void setConnectionCallback(const ConnectionCallback &cb) 
-    { connectionCallback_ = cb; }
+    { mutableCallbacks()->connectionCallback = cb; }
     void setMessageCallback(const MessageCallback &cb) 
-    { messageCallback_ = cb; }
+    { mutableCallbacks()->messageCallback = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) 
-    { writeCompleteCallback_ = cb; }
+    { mutableCallbacks()->writeCompleteCallback = cb; }
     void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
-    { highWaterMarkCallback_=cb; highWaterMark_=highWaterMark; }
+    { mutableCallbacks()->highWaterMarkCallback = cb; highWaterMark_ = highWaterMark; }
     void setCloseCallback(const CloseCallback &cb)
-    { closeCallback_=cb; }
+    { mutableCallbacks()->closeCallback = cb; }
+    void setHighWaterMark(size_t highWaterMark)
+    { highWaterMark_ = highWaterMark; }
+    // 自动流控: outputBuffer_超过高水位时暂停读,handleWrite把它发送到低水位以下时恢复读
+    void setFlowControl(bool on, size_t lowWaterMark)
+    { flowControl_ = on; lowWaterMark_ = lowWaterMark; }
+    // 每次可读事件最多从socket读取bytes字节(0为不限制),剩下的数据留在内核中,
+    // 由水平触发的epoll在下一轮再报告,避免一个连接独占一轮事件循环
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+
+    // 写合并: 事件处理期间的小块send先攒在outputBuffer_中,本轮事件处理完后一次写出;
+    // 攒够kMaxCorkBytes的send立即发送. 在loop线程中或连接建立前设置
+    void setCorking(bool on) { corking_ = on; }
+    static const size_t kMaxCorkBytes = 64 * 1024;
+
+    // outputBuffer_的大小变化计入所属loop的计数器(TcpServer的全局输出内存预算)
+    void setOutputCounter(OutputBudget::LoopCounter *counter)
+    { outputCounter_ = counter; }
+
+    // 在此连接上启用TLS,需在ConnectEstablished之前调用.
+    // 握手完成后才触发连接建立的回调,messageCallback收到的是解密后的明文,send的数据先加密再发送
+    // hostName: 客户端用于SNI与证书校验,见TlsSession
+    void startTls(const TlsContextPtr &context, const std::string &hostName = std::string());
+    // 未启用TLS时为空
+    const TlsSession *tlsSession() const { return tls_.get(); }
+
+    // 改为通过transport收发数据(如LoopbackTransport),需在ConnectEstablished之前调用,
+    // 构造时传入的sockfd须为transport->fd()
+    void setTransport(TransportPtr transport);
+    // 未设置时为空,直接读写socket
+    const Transport *transport() const { return transport_.get(); }
 
     // 连接建立
     void ConnectEstablished();
@@ -65,30 +143,85 @@ private:
     void handleError();
 
     void sendInLoop(const void *message, size_t len);
+    // slices与iov一一对应(可为空),非空的块没写完时只保留引用
+    void sendInLoop(const struct iovec *iov, int iovcnt, const ScatterMessage::Slice *slices = nullptr);
+    void sendSliceInLoop(const ScatterMessage::Slice &payload);
+    void sendStringInLoop(const std::string &message);
+    void sendMessageInLoop(const ScatterMessage &message);
+    void startReadInLoop();
+    void stopReadInLoop();
+    void forceCloseInLoop();
+    void updateOutputBytes();
+    size_t pendingBytes() const { return outputBuffer_.readableBytes() + pendingSliceBytes_; }
+    void appendPending(const char *data, size_t len, const ScatterMessage::Slice *slice);
+    ssize_t writePending(int *savedErrno);
+    void retrievePending(size_t len);
+    void outputBufferGrew(size_t oldLen, size_t newLen);
+    void flushCorked();
+    void flushOutput(size_t oldLen);
+    void handleTlsRead(Timestamp receiveTime);
+    void handleDoorbell(Timestamp receiveTime);
+    ssize_t readInput(Buffer *buf, int *savedErrno);
+    ssize_t writeOutput(const struct iovec *iov, int iovcnt);
+    // 是否在等待发送空间. 使用Transport时门铃只注册读事件,等待发送空间只做标记
+    bool isWriting() const { return transport_ ? transportWriting_ : channel_.isWriting(); }
+    void enableWriting();
+    void disableWriting();
+    void deliverMessage(Timestamp receiveTime, size_t newBytes);
+    void traceWritten();
+    void finishTrace();
+    void sendTlsInLoop(const struct iovec *iov, int iovcnt);
+    ConnectionCallbacks *mutableCallbacks();
+    void setupChannel();
 
     EventLoop *loop_; // 指向管理此连接的subloop
-    const std::string name_; // TcpConnection_1、TcpConnection_2
+    const std::shared_ptr<const std::string> namePrefix_;
+    const int64_t id_; // 为0时连接名就是namePrefix_
     enum StateE{ kDisconnected, kConnecting, kConnected, kDisconnecting };
     void setState(StateE state) { state_ = state; }
     std::atomic_int state_;
     
     bool reading_; // 是否正在监听读事件
+    bool announced_; // 是否已执行连接建立的回调(TLS连接在握手完成后才执行)
 
-    std::unique_ptr<Socket> socket_; // 封装 服务器的与客户端通信的fd
-    std::unique_ptr<Channel> channel_;
+    // Socket与Channel直接嵌入连接对象,不再单独分配
+    Socket socket_; // 封装 服务器的与客户端通信的fd
+    Channel channel_;
 
     const InetAddress localAddr_;
     const InetAddress peerAddr_;
 
-    ConnectionCallback connectionCallback_;       // 连接状态变化的回调(建立或断开)
-    MessageCallback messageCallback_;             // 收到新数据并存入inputBuffer_后触发此回调
-    WriteCompleteCallback writeCompleteCallback_; // 数据全部发送完成后的回调
-    HighWaterMarkCallback highWaterMarkCallback_; // 待发送数据超过阈值时触发
-    CloseCallback closeCallback_; // 连接关闭时触发
+    ConnectionCallbacksPtr callbacks_; // 通常与同一服务器的其他连接共享
     size_t highWaterMark_;
+    size_t lowWaterMark_;
+    bool flowControl_;      // 是否开启自动流控
+    bool pausedByFlowControl_; // 读事件是否因流控被暂停(用户主动stopRead的不自动恢复)
+    size_t readBudget_; // 每次可读事件最多读取的字节数,0为不限制
+    bool corking_; // 是否开启写合并
+    bool corked_;  // outputBuffer_中有攒着的数据,已登记在本轮事件处理完后发送
+    bool transportWriting_; // 使用Transport时是否在等待发送空间
+
+    OutputBudget::LoopCounter *outputCounter_; // 所属loop的待发送字节计数器,可为空
+    std::atomic<size_t> outputBytes_;          // 上次计入的outputBuffer_大小
+    std::atomic<int64_t> highWaterSince_;
+
+    std::shared_ptr<void> context_;
+    std::unique_ptr<TlsSession> tls_; // 未启用TLS时为空
+    TransportPtr transport_; // 为空时直接读写socket. 要先于socket_析构(门铃关闭前告知对端),所以声明在其后
+    std::unique_ptr<TraceSpan> trace_; // 正在追踪的请求,未采样时为空
+    int64_t captureId_; // 流量录制中的连接号,连接建立时未在录制则为0
 
     Buffer inputBuffer_;  // 存储从socket读取的数据,供messageCallback_消费
     Buffer outputBuffer_; // 暂存待发送数据，应对TCP发送窗口满的情况。
+
+    // 排在outputBuffer_之后的待发送数据块,引用调用方的payload而不拷贝.
+    // 不为空时之后的所有待发送数据都排在这里,保证发送顺序
+    struct PendingSlice{
+        ScatterMessage::Slice data;
+        size_t offset; // data中已发送的字节数
+    };
+    std::deque<PendingSlice> pendingSlices_;
+    size_t pendingSliceBytes_;
 };
 
 /**
@@ -4,6 +4,7 @@
 
 #include <functional>
 #include <strings.h>
+#include <algorithm>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop){
     if(loop == nullptr){
@@ -23,6 +24,13 @@ TcpServer::TcpServer(EventLoop *loop,
                      , threadPool_(new EventLoopThreadPoll(loop,name_))
                      , connectionCallback_()
                      , messageCallback_()
+                     , connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_))
+                     , flowControl_(false)
+                     , corking_(false)
+                     , readBudget_(0)
+                     , highWaterMark_(64*1024*1024)
+                     , lowWaterMark_(0)
+                     , budgetRecheckTimer_(0)
                      , nextConnId_(1)
                      , started_(0)
 {
@@ -32,6 +40,9 @@ TcpServer::TcpServer(EventLoop *loop,
 }
 
 TcpServer::~TcpServer(){
+    if(budgetRecheckTimer_){
+        loop_->cancel(budgetRecheckTimer_);
+    }
     for(auto& item : connections_){
         TcpConnectionPtr conn(item.second); // 局部的shared_ptr出作用域可以自动释放new出来的TcpConnection对象资源
         item.second.reset();
@@ -55,34 +66,69 @@ void TcpServer::start(){
 
 // 有一个新的客户端连接,acceptor会执行此回调操作
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr){
-    // 轮询算法,选择一个subloop
-    EventLoop *ioLoop = threadPool_->getNextLoop();
-    char buf[64] = {0};
-    snprintf(buf, sizeof(buf), "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    std::string connName = name_ + buf;
-
-    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n", 
-        name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
-    
     // 通过sockfd获取其绑定的本机的ip+port
-    sockaddr_in local;
+    sockaddr_storage local;
     bzero(&local, sizeof(local));
     socklen_t addrlen = sizeof(local);
     if(::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0){
         LOG_ERROR("sockets::getLocalAddr");
     }
-    InetAddress localAddr(local);
+    InetAddress localAddr((sockaddr *)&local, addrlen);
+    addConnection(sockfd, localAddr, peerAddr, TransportPtr());
+}
 
-    //根据连接成功的sockfd,创建TcpConnection连接对象
-    TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
+void TcpServer::acceptTransport(TransportPtr transport, const InetAddress &peerAddr){
+    // std::function要求可复制,用shared_ptr持有; 回调没有执行就被丢弃时transport随之释放
+    std::shared_ptr<TransportPtr> holder = std::make_shared<TransportPtr>(std::move(transport));
+    loop_->runInLoop([this, holder, peerAddr](){
+        int fd = (*holder)->fd();
+        addConnection(fd, InetAddress(), peerAddr, std::move(*holder));
+    });
+}
+
+// 在mainloop中执行, transport为空时直接读写sockfd
+void TcpServer::addConnection(int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr,
+                              TransportPtr transport){
+    // 轮询算法,选择一个subloop
+    EventLoop *ioLoop = threadPool_->getNextLoop();
+    int64_t connId = nextConnId_++;
+
+    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s#%ld] from %s \n", 
+        name_.c_str(), connNamePrefix_->c_str(), (long)connId, peerAddr.toIpPort().c_str());
+
+    //根据连接成功的sockfd,创建TcpConnection连接对象,连同控制块一起从该subloop的内存池分配
+    std::shared_ptr<FixedSizePool> &pool = connectionPools_[ioLoop];
+    if(!pool){
+        pool = std::make_shared<FixedSizePool>();
+    }
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(PoolAllocator<TcpConnection>(pool),
+        ioLoop, connNamePrefix_, connId, sockfd, localAddr, peerAddr);
 
-    connections_[connName] = conn;
+    connections_[connId] = conn;
     
-    conn->setConnectionCallback(connectionCallback_);
-    conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));//设置了如何关闭连接的回调
+    if(!callbacks_){
+        callbacks_ = std::make_shared<ConnectionCallbacks>();
+        callbacks_->connectionCallback = connectionCallback_;
+        callbacks_->messageCallback = messageCallback_;
+        callbacks_->writeCompleteCallback = writeCompleteCallback_;
+        callbacks_->closeCallback = std::bind(&TcpServer::removeConnection, this, std::placeholders::_1);//设置了如何关闭连接的回调
+    }
+    conn->setCallbacks(callbacks_);
+    if(transport){
+        conn->setTransport(std::move(transport));
+    }
+    if(flowControl_){
+        conn->setHighWaterMark(highWaterMark_);
+        conn->setFlowControl(true, lowWaterMark_);
+    }
+    conn->setCorking(corking_);
+    conn->setReadBudget(readBudget_);
+    if(tlsContext_){
+        conn->startTls(tlsContext_);
+    }
+    if(outputBudget_){
+        conn->setOutputCounter(outputBudget_->counterOf(ioLoop));
+    }
 
     ioLoop->runInLoop(std::bind(&TcpConnection::ConnectEstablished, conn));
 }
@@ -94,7 +140,50 @@ void TcpServer::removeConnection(const TcpConnectionPtr &conn){
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn){
     LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n", name_.c_str(), conn->name().c_str());
 
-    size_t n = connections_.erase(conn->name());
+    size_t n = connections_.erase(conn->id());
     EventLoop *ioLoop = conn->getloop();
     ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
-}
\ No newline at end of file
+}
+void TcpServer::setOutputBudget(size_t maxBytes, const OutputBudget::EvictionPolicy &policy){
+    // 超预算的通知来自subloop线程,转到mainloop中处理
+    outputBudget_.reset(new OutputBudget(maxBytes, [this](){
+        loop_->queueInLoop(std::bind(&TcpServer::enforceOutputBudget, this));
+    }));
+    evictionPolicy_ = policy;
+}
+
+// 在mainloop中执行: 汇总各loop的计数,超过预算则按策略关闭连接
+// 超预算期间subloop不再通知,由这里定时重新检查,直到总量回到预算以内
+void TcpServer::enforceOutputBudget(){
+    budgetRecheckTimer_ = 0;
+    size_t total = outputBudget_->totalBytes();
+    if(total <= outputBudget_->maxBytes()){
+        outputBudget_->checkDone();
+        return;
+    }
+    budgetRecheckTimer_ = loop_->runAfter(OutputBudget::kRecheckInterval,
+                                          std::bind(&TcpServer::enforceOutputBudget, this));
+    size_t excess = total - outputBudget_->maxBytes();
+
+    std::vector<OutputBudget::OutputStat> stats;
+    for(auto &item : connections_){
+        const TcpConnectionPtr &conn = item.second;
+        size_t bytes = conn->outputBytes();
+        if(!conn->connected()){ // 正在关闭的连接,其占用的内存即将释放
+            excess -= std::min(excess, bytes);
+        }
+        else if(bytes > 0){
+            stats.push_back({conn, bytes, conn->highWaterSince()});
+        }
+    }
+    evictionPolicy_(stats);
+    for(const OutputBudget::OutputStat &stat : stats){
+        if(excess == 0){
+            break;
+        }
+        LOG_INFO("TcpServer::enforceOutputBudget [%s] - evict connection %s with %lu bytes queued\n",
+            name_.c_str(), stat.conn->name().c_str(), stat.bytes);
+        stat.conn->forceClose();
+        excess -= std::min(excess, stat.bytes);
+    }
+}
@@ -8,6 +8,8 @@
 #include "Callbacks.h"
 #include "TcpConnection.h"
 #include "Buffer.h"
+#include "OutputBudget.h"
+#include "FixedSizePool.h"
 
 #include <functional>
 #include <memory>
@@ -29,10 +31,27 @@ public:
         const std::string &nameArg, Option option = kNoReusePort);
     ~TcpServer();
 
+    const std::string &name() const { return name_; }
+    const std::string &ipPort() const { return ipPort_; }
+    EventLoop *getLoop() const { return loop_; }
+
     void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
-    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
-    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
-    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    // 回调在之后建立的连接间共享,修改后重新生成共享的那一份
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; callbacks_.reset(); }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; callbacks_.reset(); }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; callbacks_.reset(); }
+    // 为之后建立的所有连接开启自动流控
+    void setFlowControl(size_t highWaterMark, size_t lowWaterMark)
+    { flowControl_ = true; highWaterMark_ = highWaterMark; lowWaterMark_ = lowWaterMark; }
+    // 为之后建立的所有连接设置读预算,见TcpConnection::setReadBudget
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+    // 为之后建立的所有连接开启写合并,见TcpConnection::setCorking
+    void setCorking(bool on) { corking_ = on; }
+    // 之后建立的所有连接都使用TLS, context需为TlsContext::kServer模式并已加载证书
+    void setTlsContext(const TlsContextPtr &context) { tlsContext_ = context; }
+    // 所有连接outputBuffer_的总内存预算,超过后按policy淘汰连接. 需在start之前调用
+    void setOutputBudget(size_t maxBytes,
+                         const OutputBudget::EvictionPolicy &policy = OutputBudget::evictLargestFirst);
 
     // 设置底层subloop个数
     void setThreadNum(int numThreads);
@@ -40,10 +59,19 @@ public:
     // 开始服务器监听
     void start();
 
+    // 接入一条不经过socket的连接(如LoopbackTransport的一端),与accept到的连接一样分配subloop、
+    // 设置回调与选项. 可在任意线程调用,需在start之后
+    void acceptTransport(TransportPtr transport, const InetAddress &peerAddr = InetAddress());
+
+    // 所有subloop(单线程时为mainloop),需在start之后调用. 配合invokeOnAll按loop汇总统计、下发配置
+    std::vector<EventLoop *> getAllLoops() const { return threadPool_->getAllLoops(); }
+
 private:
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    void addConnection(int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr, TransportPtr transport);
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    void enforceOutputBudget();
 
     EventLoop *loop_; // mainloop,运行Acceptor
     std::unique_ptr<Acceptor> acceptor_; // 运行在mainloop,任务就是监听新连接
@@ -56,11 +84,27 @@ private:
     ConnectionCallback connectionCallback_; // 连接状态变化的回调(建立或断开)
     MessageCallback messageCallback_; // 收到客户端数据时触发
     WriteCompleteCallback writeCompleteCallback_; // 消数据全部发送完成后的回调
+    ConnectionCallbacksPtr callbacks_; // 所有连接共享的回调,第一个连接建立时生成
+    std::shared_ptr<const std::string> connNamePrefix_; // 连接名为 name-ip:port#id
+
+    // 每个subloop一个内存池,TcpConnection连同shared_ptr控制块从中分配. 只在mainloop中访问
+    std::unordered_map<EventLoop *, std::shared_ptr<FixedSizePool>> connectionPools_;
+
+    bool flowControl_; // 新连接是否开启自动流控
+    bool corking_;     // 新连接是否开启写合并
+    size_t readBudget_; // 新连接的读预算
+    TlsContextPtr tlsContext_; // 为空时不使用TLS
+    size_t highWaterMark_;
+    size_t lowWaterMark_;
+
+    std::unique_ptr<OutputBudget> outputBudget_; // 未设置预算时为空
+    OutputBudget::EvictionPolicy evictionPolicy_;
+    TimerId budgetRecheckTimer_; // 仍超预算时的重新检查,0表示没有
 
     ThreadInitCallback threadInitCallback_; // subloop线程初始化的回调
     std::atomic_int started_;
 
-    int nextConnId_;
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    int64_t nextConnId_;
+    using ConnectionMap = std::unordered_map<int64_t, TcpConnectionPtr>; // key为连接id
     ConnectionMap connections_; // 保存所有活跃的连接
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "TimerQueue.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <strings.h>
+#include <vector>
+
+std::atomic<int64_t> TimerQueue::s_numCreated_(0);
+
+static int createTimerfd(){
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(timerfd < 0){
+        LOG_FATAL("timerfd_create error:%d \n", errno);
+    }
+    return timerfd;
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+{
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this, std::placeholders::_1));
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue(){
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval){
+    TimerId timerId = ++s_numCreated_;
+    Timer timer{std::move(cb), when.microSecondsSinceEpoch(),
+                static_cast<int64_t>(interval * Timestamp::kMicroSecondsPerSecond)};
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timerId, timer));
+    return timerId;
+}
+
+void TimerQueue::cancel(TimerId timerId){
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(TimerId timerId, const Timer &timer){
+    bool earliestChanged = entries_.empty() || timer.expiration < entries_.begin()->first;
+    timers_[timerId] = timer;
+    entries_.insert(Entry(timer.expiration, timerId));
+    if(earliestChanged){
+        resetTimerfd();
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId){
+    auto it = timers_.find(timerId);
+    if(it != timers_.end()){
+        entries_.erase(Entry(it->second.expiration, timerId));
+        timers_.erase(it);
+    }
+}
+
+// 按最早的到期时间设置timerfd; 没有定时器时关闭timerfd
+void TimerQueue::resetTimerfd(){
+    struct itimerspec newValue;
+    bzero(&newValue, sizeof(newValue));
+    if(!entries_.empty()){
+        int64_t microseconds = entries_.begin()->first - Timestamp::now().microSecondsSinceEpoch();
+        if(microseconds < 100){
+            microseconds = 100;
+        }
+        newValue.it_value.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+        newValue.it_value.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    }
+    if(::timerfd_settime(timerfd_, 0, &newValue, NULL) < 0){
+        LOG_ERROR("timerfd_settime error:%d \n", errno);
+    }
+}
+
+void TimerQueue::handleRead(Timestamp receiveTime){
+    uint64_t howmany = 0;
+    ::read(timerfd_, &howmany, sizeof(howmany));
+
+    // 先取出所有到期的定时器再执行回调,回调中可以安全地添加或取消定时器
+    // 用本轮poll返回的时间判断到期,省去一次取时间
+    int64_t now = receiveTime.microSecondsSinceEpoch();
+    std::vector<TimerId> expired;
+    auto end = entries_.lower_bound(Entry(now + 1, 0));
+    for(auto it = entries_.begin(); it != end; ++it){
+        expired.push_back(it->second);
+    }
+    entries_.erase(entries_.begin(), end);
+
+    for(TimerId timerId : expired){
+        auto it = timers_.find(timerId);
+        if(it == timers_.end()){ // 被之前执行的回调取消了
+            continue;
+        }
+        TimerCallback cb(std::move(it->second.callback));
+        cb();
+        it = timers_.find(timerId); // 回调中可能修改了timers_
+        if(it == timers_.end()){
+            continue;
+        }
+        if(it->second.interval > 0){
+            it->second.callback = std::move(cb);
+            it->second.expiration = now + it->second.interval;
+            entries_.insert(Entry(it->second.expiration, timerId));
+        }
+        else{
+            timers_.erase(it);
+        }
+    }
+    resetTimerfd();
+}
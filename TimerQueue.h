@@ -0,0 +1,53 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Channel.h"
+
+#include <functional>
+#include <atomic>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <stdint.h>
+
+class EventLoop;
+
+using TimerId = int64_t;
+
+/**
+ * 定时器队列: 所有定时器按到期时间排序,用一个timerfd在最早的到期时间唤醒loop
+ * timerfd作为一个普通Channel注册到Poller,到期回调在loop线程中执行
+ */
+class TimerQueue : noncopyable {
+public:
+    using TimerCallback = std::function<void()>;
+
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 可在任意线程调用; interval > 0 表示重复定时器(秒)
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    void cancel(TimerId timerId);
+
+private:
+    struct Timer{
+        TimerCallback callback;
+        int64_t expiration; // 微秒
+        int64_t interval;   // 微秒, 0表示只执行一次
+    };
+    // (到期时间, TimerId), TimerId保证同一时刻到期的定时器也能区分
+    using Entry = std::pair<int64_t, TimerId>;
+
+    void addTimerInLoop(TimerId timerId, const Timer &timer);
+    void cancelInLoop(TimerId timerId);
+    void handleRead(Timestamp receiveTime); // timerfd可读,执行到期的定时器
+    void resetTimerfd();
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    std::set<Entry> entries_;
+    std::unordered_map<TimerId, Timer> timers_;
+    static std::atomic<int64_t> s_numCreated_;
+};
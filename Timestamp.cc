@@ -1,28 +1,39 @@
 #include "Timestamp.h"
 
 #include <time.h>
+#include <sys/time.h>
+#include <stdio.h>
 
 Timestamp::Timestamp() : microSecondsSinceEpoch_(0) {}
 
 Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
     :microSecondsSinceEpoch_(microSecondsSinceEpoch){}
 
-// 返回当前时间的Timestamp对象
+// 返回当前时间的Timestamp对象(微秒精度,定时器依赖它)
 Timestamp Timestamp::now(){
-    // time(NULL)返回 时间戳（自Unix纪元到当前时间的秒数）
-    return Timestamp(time(NULL)); // time_t -> int64_t 安全
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return Timestamp(static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
+// 每个线程缓存上一次格式化的秒及其结果,日志等场景同一秒内反复格式化时不再调用localtime
+static thread_local time_t t_lastSecond = -1;
+static thread_local char t_formatted[64];
+
 std::string Timestamp::toString() const{
-    char buf[128] = {0};
-    // 将存储的时间戳 转为tm结构
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-             tm_time->tm_year + 1900,
-             tm_time->tm_mon + 1,
-             tm_time->tm_mday,
-             tm_time->tm_hour,
-             tm_time->tm_min,
-             tm_time->tm_sec);
-    return buf;
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    if(seconds != t_lastSecond){
+        // 将存储的时间戳 转为tm结构
+        struct tm tm_time;
+        localtime_r(&seconds, &tm_time);
+        snprintf(t_formatted, sizeof(t_formatted), "%4d/%02d/%02d %02d:%02d:%02d",
+                 tm_time.tm_year + 1900,
+                 tm_time.tm_mon + 1,
+                 tm_time.tm_mday,
+                 tm_time.tm_hour,
+                 tm_time.tm_min,
+                 tm_time.tm_sec);
+        t_lastSecond = seconds;
+    }
+    return t_formatted;
 }
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
 
 // 时间类
 class Timestamp{
@@ -9,8 +10,44 @@ public:
     Timestamp();
     explicit Timestamp(int64_t microSecondsSinceEpoch);
     static Timestamp now();
+    // "年/月/日 时:分:秒",同一线程内同一秒只格式化一次
     std::string toString() const;
 
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
 private:
     int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs){
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+inline bool operator>(Timestamp lhs, Timestamp rhs) { return rhs < lhs; }
+inline bool operator<=(Timestamp lhs, Timestamp rhs) { return !(rhs < lhs); }
+inline bool operator>=(Timestamp lhs, Timestamp rhs) { return !(lhs < rhs); }
+inline bool operator==(Timestamp lhs, Timestamp rhs){
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+inline bool operator!=(Timestamp lhs, Timestamp rhs) { return !(lhs == rhs); }
+
+// high - low,单位微秒
+inline int64_t microSecondsDifference(Timestamp high, Timestamp low){
+    return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
+// high - low,单位秒
+inline double timeDifference(Timestamp high, Timestamp low){
+    return static_cast<double>(microSecondsDifference(high, low)) / Timestamp::kMicroSecondsPerSecond;
+}
+
+inline Timestamp addMicroSeconds(Timestamp timestamp, int64_t microseconds){
+    return Timestamp(timestamp.microSecondsSinceEpoch() + microseconds);
+}
+
+// seconds可为小数,精确到微秒
+inline Timestamp addTime(Timestamp timestamp, double seconds){
+    return addMicroSeconds(timestamp, static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond));
+}
@@ -0,0 +1,136 @@
+#include "TlsContext.h"
+#include "logger.h"
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+void TlsContext::logErrors(const char *what){
+    unsigned long err;
+    char errBuf[256]; // LOG_ERROR宏内部定义了buf
+    while((err = ERR_get_error()) != 0){
+        ERR_error_string_n(err, errBuf, sizeof(errBuf));
+        LOG_ERROR("%s: %s \n", what, errBuf);
+    }
+}
+
+// 客户端收到新会话(TLS1.3中是握手之后服务端发来的ticket)时由OpenSSL调用
+static int newSessionCallback(SSL *ssl, SSL_SESSION *session){
+    TlsContext *context = static_cast<TlsContext *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    const std::string *key = static_cast<const std::string *>(SSL_get_app_data(ssl));
+    // 不带ticket的会话无法恢复,不要让它替换掉缓存中可用的会话
+    if(context == nullptr || key == nullptr || !context->sessionResumption()
+        || !SSL_SESSION_is_resumable(session)){
+        return 0;
+    }
+    context->storeSession(*key, session);
+    return 1; // 保留session的引用
+}
+
+TlsContext::TlsContext(Mode mode)
+    : mode_(mode)
+    , ctx_(SSL_CTX_new(mode == kServer ? TLS_server_method() : TLS_client_method()))
+    , sessionResumption_(true)
+    , verifyPeer_(false)
+{
+    if(ctx_ == nullptr){
+        logErrors("SSL_CTX_new");
+        LOG_FATAL("%s:%s:%d TlsContext create error \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    SSL_CTX_set_app_data(ctx_, this);
+    SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+    // 空闲连接不保留读写记录的缓冲区
+    SSL_CTX_set_mode(ctx_, SSL_MODE_RELEASE_BUFFERS);
+    if(mode_ == kServer){
+        static const unsigned char kSessionIdContext[] = "mymuduo";
+        SSL_CTX_set_session_id_context(ctx_, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+        SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_SERVER);
+    }
+    else{
+        // 默认用系统的CA校验服务端证书,需要自签名证书的测试显式调用setVerifyNone
+        // 加载CA失败时仍然校验(所有证书都通不过),不退回到不校验
+        SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER, nullptr);
+        verifyPeer_ = true;
+        if(SSL_CTX_set_default_verify_paths(ctx_) != 1){
+            logErrors("SSL_CTX_set_default_verify_paths");
+        }
+        SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx_, newSessionCallback);
+    }
+}
+
+TlsContext::~TlsContext(){
+    for(auto &item : sessions_){
+        for(SSL_SESSION *session : item.second){
+            SSL_SESSION_free(session);
+        }
+    }
+    SSL_CTX_free(ctx_);
+}
+
+bool TlsContext::loadCertificate(const std::string &certFile, const std::string &keyFile){
+    if(SSL_CTX_use_certificate_chain_file(ctx_, certFile.c_str()) != 1){
+        logErrors("SSL_CTX_use_certificate_chain_file");
+        return false;
+    }
+    if(SSL_CTX_use_PrivateKey_file(ctx_, keyFile.c_str(), SSL_FILETYPE_PEM) != 1
+        || SSL_CTX_check_private_key(ctx_) != 1){
+        logErrors("SSL_CTX_use_PrivateKey_file");
+        return false;
+    }
+    return true;
+}
+
+bool TlsContext::setVerifyPeer(const std::string &caFile){
+    int ok = caFile.empty() ? SSL_CTX_set_default_verify_paths(ctx_)
+                            : SSL_CTX_load_verify_locations(ctx_, caFile.c_str(), nullptr);
+    if(ok != 1){
+        logErrors("TlsContext::setVerifyPeer");
+        return false;
+    }
+    SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER, nullptr);
+    verifyPeer_ = true;
+    return true;
+}
+
+void TlsContext::setVerifyNone(){
+    SSL_CTX_set_verify(ctx_, SSL_VERIFY_NONE, nullptr);
+    verifyPeer_ = false;
+}
+
+void TlsContext::setSessionResumption(bool on){
+    sessionResumption_ = on;
+    if(mode_ == kServer){
+        if(on){
+            SSL_CTX_clear_options(ctx_, SSL_OP_NO_TICKET);
+            SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_SERVER);
+            SSL_CTX_set_num_tickets(ctx_, 2); // OpenSSL的默认值,每次握手后补充客户端用掉的ticket
+        }
+        else{
+            SSL_CTX_set_options(ctx_, SSL_OP_NO_TICKET);
+            SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_OFF);
+            SSL_CTX_set_num_tickets(ctx_, 0);
+        }
+    }
+}
+
+void TlsContext::storeSession(const std::string &key, SSL_SESSION *session){
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<SSL_SESSION *> &sessions = sessions_[key];
+    if(sessions.size() >= kMaxSessionsPerPeer){ // 丢弃最旧的
+        SSL_SESSION_free(sessions.front());
+        sessions.erase(sessions.begin());
+    }
+    sessions.push_back(session);
+}
+
+// 优先使用最新的会话
+SSL_SESSION *TlsContext::takeSession(const std::string &key){
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = sessions_.find(key);
+    if(it == sessions_.end() || it->second.empty()){
+        return nullptr;
+    }
+    SSL_SESSION *session = it->second.back();
+    it->second.pop_back();
+    return session;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// OpenSSL的类型只做前置声明,使用者不必包含OpenSSL头文件
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+/**
+ * 封装SSL_CTX, 一个TcpServer或TcpClient的所有TLS连接共享一个TlsContext
+ * 服务端: 加载证书与私钥, 开启会话缓存并签发session ticket
+ * 客户端: 默认用系统的CA校验服务端证书,并按TcpClient::setTlsContext给出的主机名校验
+ *         按服务端地址缓存最近收到的几个会话(ticket),下次连接同一地址时取出一个恢复会话,省去完整握手.
+ *         TLS1.3的ticket只使用一次,并发的连接不会共用同一个ticket
+ * SSL_CTX本身是线程安全的,多个subloop可以同时用它创建连接
+ */
+class TlsContext : noncopyable{
+public:
+    enum Mode{ kServer, kClient };
+
+    explicit TlsContext(Mode mode);
+    ~TlsContext();
+
+    bool isServer() const { return mode_ == kServer; }
+
+    // 服务端: 加载PEM格式的证书链与私钥,失败返回false
+    bool loadCertificate(const std::string &certFile, const std::string &keyFile);
+    // 客户端: 校验服务端证书, caFile为空时使用系统默认的CA(默认即如此)
+    // 证书中的主机名按TcpClient::setTlsContext给出的hostName校验,没有给出时连接会失败
+    bool setVerifyPeer(const std::string &caFile);
+    // 客户端: 不校验服务端证书,任何人都能冒充服务端. 只用于测试与压测
+    void setVerifyNone();
+    bool verifyPeer() const { return verifyPeer_; }
+    // 会话恢复(服务端的会话缓存与session ticket, 客户端的会话缓存),默认开启
+    void setSessionResumption(bool on);
+    bool sessionResumption() const { return sessionResumption_; }
+
+    // 用于OpenSSL的其他设置,如从内存加载证书、指定密码套件
+    ssl_ctx_st *nativeHandle() { return ctx_; }
+
+    // 客户端会话缓存, key为服务端地址. 取出的会话不再留在缓存中,由调用方释放
+    void storeSession(const std::string &key, ssl_session_st *session);
+    ssl_session_st *takeSession(const std::string &key);
+
+    // 取出并输出当前线程OpenSSL错误队列中的所有错误
+    static void logErrors(const char *what);
+
+private:
+    const Mode mode_;
+    ssl_ctx_st *ctx_;
+    bool sessionResumption_;
+    bool verifyPeer_;
+
+    std::mutex mutex_;
+    static const size_t kMaxSessionsPerPeer = 4;
+    std::unordered_map<std::string, std::vector<ssl_session_st *>> sessions_; // 受mutex_保护
+};
+
+using TlsContextPtr = std::shared_ptr<TlsContext>;
@@ -0,0 +1,211 @@
+#include "TlsSession.h"
+#include "logger.h"
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <limits.h>
+#include <string.h>
+
+/**
+ * 以Buffer为后端的BIO: 读时从Buffer中取出可读数据,写时追加到Buffer
+ * 没有可读数据时设置重试标志,SSL_read/SSL_do_handshake随之返回SSL_ERROR_WANT_READ
+ */
+static int bufferWrite(BIO *bio, const char *data, int len){
+    static_cast<Buffer *>(BIO_get_data(bio))->append(data, len);
+    return len;
+}
+
+static int bufferRead(BIO *bio, char *data, int len){
+    Buffer *buf = static_cast<Buffer *>(BIO_get_data(bio));
+    BIO_clear_retry_flags(bio);
+    if(buf->readableBytes() == 0){
+        BIO_set_retry_read(bio);
+        return -1;
+    }
+    size_t n = std::min(buf->readableBytes(), static_cast<size_t>(len));
+    ::memcpy(data, buf->peek(), n);
+    buf->retrieve(n);
+    return static_cast<int>(n);
+}
+
+static long bufferCtrl(BIO *, int cmd, long, void *){
+    return cmd == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+static int bufferCreate(BIO *bio){
+    BIO_set_init(bio, 1);
+    return 1;
+}
+
+static BIO_METHOD *bufferMethod(){
+    static BIO_METHOD *method = [](){
+        BIO_METHOD *m = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "mymuduo Buffer");
+        BIO_meth_set_write(m, bufferWrite);
+        BIO_meth_set_read(m, bufferRead);
+        BIO_meth_set_ctrl(m, bufferCtrl);
+        BIO_meth_set_create(m, bufferCreate);
+        return m;
+    }();
+    return method;
+}
+
+static BIO *newBufferBio(Buffer *buf){
+    BIO *bio = BIO_new(bufferMethod());
+    BIO_set_data(bio, buf);
+    return bio;
+}
+
+static bool isIpAddress(const std::string &host){
+    unsigned char addr[sizeof(struct in6_addr)];
+    return ::inet_pton(AF_INET, host.c_str(), addr) == 1 || ::inet_pton(AF_INET6, host.c_str(), addr) == 1;
+}
+
+TlsSession::TlsSession(const TlsContextPtr &context, Buffer *cipherOut, const std::string &peerKey,
+                       const std::string &hostName)
+    : context_(context)
+    , peerKey_(peerKey)
+    , ssl_(SSL_new(context->nativeHandle()))
+    , cipherIn_(0)
+    , pendingPlain_(0)
+    , established_(false)
+    , shutdownPending_(false)
+    , closeNotifySent_(false)
+    , configError_(false)
+{
+    if(ssl_ == nullptr){
+        TlsContext::logErrors("SSL_new");
+        LOG_FATAL("%s:%s:%d TlsSession create error \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    SSL_set_bio(ssl_, newBufferBio(&cipherIn_), newBufferBio(cipherOut));
+    if(context_->isServer()){
+        SSL_set_accept_state(ssl_);
+    }
+    else{
+        SSL_set_connect_state(ssl_);
+        SSL_set_app_data(ssl_, const_cast<std::string *>(&peerKey_)); // 新会话按peerKey_缓存
+        if(!hostName.empty()){
+            // SNI不能是IP地址; 校验的主机名只在SSL_VERIFY_PEER时生效
+            bool ok = isIpAddress(hostName)
+                ? X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl_), hostName.c_str()) == 1
+                : SSL_set_tlsext_host_name(ssl_, hostName.c_str()) == 1 && SSL_set1_host(ssl_, hostName.c_str()) == 1;
+            if(!ok){
+                TlsContext::logErrors("TlsSession set host name");
+                configError_ = true;
+            }
+        }
+        else if(context_->verifyPeer()){
+            // 只校验证书链而不校验主机名,任何持有可信证书的服务端都能冒充
+            LOG_ERROR("TlsSession: peer verification requires a host name, see TcpClient::setTlsContext \n");
+            configError_ = true;
+        }
+        if(context_->sessionResumption()){
+            SSL_SESSION *session = context_->takeSession(peerKey_);
+            if(session != nullptr){
+                SSL_set_session(ssl_, session);
+                SSL_SESSION_free(session);
+            }
+        }
+    }
+}
+
+TlsSession::~TlsSession(){
+    SSL_free(ssl_); // 同时释放两个BIO
+}
+
+bool TlsSession::start(){
+    return !configError_ && handshake();
+}
+
+bool TlsSession::sessionReused() const{
+    return SSL_session_reused(ssl_) == 1;
+}
+
+bool TlsSession::handshake(){
+    int ret = SSL_do_handshake(ssl_);
+    if(ret == 1){
+        established_ = true;
+        // 握手期间暂存的明文现在可以加密发送了,之后再发出推迟的close_notify
+        bool ok = true;
+        if(pendingPlain_.readableBytes() > 0){
+            ok = encrypt(pendingPlain_.peek(), pendingPlain_.readableBytes());
+            pendingPlain_.retrieveAll();
+        }
+        if(ok && shutdownPending_){
+            shutdown();
+        }
+        return ok;
+    }
+    if(SSL_get_error(ssl_, ret) == SSL_ERROR_WANT_READ){
+        return true;
+    }
+    TlsContext::logErrors("SSL_do_handshake");
+    return false;
+}
+
+bool TlsSession::receive(Buffer *plain){
+    if(!established_){
+        if(!handshake()){
+            return false;
+        }
+        if(!established_){
+            return true;
+        }
+    }
+    static const size_t kRecordSize = 16 * 1024; // TLS记录的最大明文长度
+    for(;;){
+        plain->ensureWriteableBytes(kRecordSize);
+        int len = static_cast<int>(std::min(plain->writableBytes(), static_cast<size_t>(INT_MAX)));
+        int n = SSL_read(ssl_, plain->beginWrite(), len);
+        if(n > 0){
+            plain->hasWritten(n);
+            continue;
+        }
+        int err = SSL_get_error(ssl_, n);
+        // 密文读完了,或对端发来了close_notify(随后的FIN由TcpConnection处理)
+        if(err == SSL_ERROR_WANT_READ || err == SSL_ERROR_ZERO_RETURN){
+            return true;
+        }
+        TlsContext::logErrors("SSL_read");
+        return false;
+    }
+}
+
+bool TlsSession::send(const void *data, size_t len){
+    if(!established_){
+        pendingPlain_.append(static_cast<const char *>(data), len);
+        return true;
+    }
+    return encrypt(data, len);
+}
+
+bool TlsSession::encrypt(const void *data, size_t len){
+    const char *p = static_cast<const char *>(data);
+    while(len > 0){
+        int chunk = static_cast<int>(std::min(len, static_cast<size_t>(INT_MAX)));
+        // 写BIO总能写完,SSL_write要么全部加密,要么出错
+        int n = SSL_write(ssl_, p, chunk);
+        if(n <= 0){
+            TlsContext::logErrors("SSL_write");
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+void TlsSession::shutdown(){
+    if(closeNotifySent_){
+        return;
+    }
+    if(!established_){
+        shutdownPending_ = true;
+        return;
+    }
+    shutdownPending_ = false;
+    closeNotifySent_ = true;
+    SSL_shutdown(ssl_);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Buffer.h"
+#include "TlsContext.h"
+
+#include <string>
+
+struct ssl_st;
+struct bio_st;
+
+/**
+ * 一个TLS连接的状态,由TcpConnection持有,只在所属loop线程中使用
+ * 读写不经过socket,而是两个以Buffer为后端的BIO:
+ *   handleRead把密文读进cipherIn_, SSL_read从中取出记录,解密后的明文直接写进连接的inputBuffer_
+ *   SSL_write加密出的记录直接追加到连接的outputBuffer_,照常由TcpConnection发送
+ */
+class TlsSession : noncopyable{
+public:
+    // cipherOut: 加密后的记录追加到这里; peerKey: 客户端按它查找可恢复的会话
+    // hostName: 客户端通过SNI发送,并按它校验服务端证书(IP地址则校验证书中的IP)
+    TlsSession(const TlsContextPtr &context, Buffer *cipherOut, const std::string &peerKey,
+               const std::string &hostName = std::string());
+    ~TlsSession();
+
+    // 开始握手,客户端此时产生ClientHello. 返回false表示出错
+    bool start();
+
+    // 从socket读到的密文存放在这里
+    Buffer *cipherInput() { return &cipherIn_; }
+    // 处理cipherIn_中的密文: 推进握手,解密出的明文追加到plain. 返回false表示出错,连接应关闭
+    bool receive(Buffer *plain);
+    // 加密后追加到cipherOut,握手完成前先暂存明文. 返回false表示出错
+    bool send(const void *data, size_t len);
+    // 发送close_notify,只发送一次. 握手完成前调用时推迟到握手完成、暂存的明文发出之后
+    void shutdown();
+
+    bool established() const { return established_; }
+    bool shutdownPending() const { return shutdownPending_; }
+    bool closeNotifySent() const { return closeNotifySent_; }
+    // 本次握手是否恢复了之前的会话
+    bool sessionReused() const;
+
+private:
+    bool handshake();
+    bool encrypt(const void *data, size_t len);
+
+    TlsContextPtr context_;
+    const std::string peerKey_; // 服务端为空
+    ssl_st *ssl_;
+    Buffer cipherIn_;
+    Buffer pendingPlain_; // 握手完成前send的明文
+    bool established_;
+    bool shutdownPending_; // 握手完成前调用了shutdown
+    bool closeNotifySent_;
+    bool configError_; // 构造时的设置出错,start时报告
+};
@@ -0,0 +1,186 @@
+#include "Tracer.h"
+#include "CurrentThread.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+
+std::atomic<int> Tracer::sampling_(0);
+std::atomic<size_t> Tracer::maxSpansPerThread_(100000);
+
+namespace{
+
+// reset()只递增这个纪元,各线程在下一次record时自己清空直方图
+std::atomic<uint64_t> g_resetEpoch(0);
+
+// 一个线程的追踪数据. 直方图只由本线程写入(包括reset); spans在采样到的请求上才访问,用锁与导出线程同步
+struct ThreadTrace{
+    explicit ThreadTrace(pid_t id) : tid(id), epoch(g_resetEpoch.load(std::memory_order_acquire)), dropped(0) {}
+
+    const pid_t tid;
+    // 直方图所属的reset纪元,与g_resetEpoch不同时直方图中是reset之前的数据
+    std::atomic<uint64_t> epoch;
+    HdrHistogram histograms[Tracer::kNumStages];
+    std::mutex mutex;
+    std::vector<TraceSpan> spans;
+    size_t dropped;
+};
+
+// 线程退出后数据仍保留在这里,直到进程退出
+std::mutex g_registryMutex;
+std::vector<std::shared_ptr<ThreadTrace>> g_registry;
+
+thread_local ThreadTrace *t_trace = nullptr;
+thread_local int t_sampleCounter = 0;
+
+ThreadTrace *threadTrace(){
+    if(t_trace == nullptr){
+        std::shared_ptr<ThreadTrace> trace = std::make_shared<ThreadTrace>(CurrentThread::tid());
+        std::unique_lock<std::mutex> lock(g_registryMutex);
+        g_registry.push_back(trace);
+        t_trace = trace.get();
+    }
+    return t_trace;
+}
+
+std::vector<std::shared_ptr<ThreadTrace>> allThreads(){
+    std::unique_lock<std::mutex> lock(g_registryMutex);
+    return g_registry;
+}
+
+void writeEvent(FILE *fp, bool *first, const char *name, pid_t pid, pid_t tid, int64_t ts, int64_t dur, int64_t connId){
+    fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"mymuduo\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                "\"ts\":%ld,\"dur\":%ld,\"args\":{\"conn\":%ld}}",
+            *first ? "" : ",", name, pid, tid, static_cast<long>(ts), static_cast<long>(dur), static_cast<long>(connId));
+    *first = false;
+}
+
+} // namespace
+
+bool Tracer::sample(){
+    if(++t_sampleCounter < sampling()){
+        return false;
+    }
+    t_sampleCounter = 0;
+    return true;
+}
+
+void Tracer::record(const TraceSpan &span){
+    ThreadTrace *trace = threadTrace();
+    uint64_t epoch = g_resetEpoch.load(std::memory_order_acquire);
+    if(trace->epoch.load(std::memory_order_relaxed) != epoch){
+        for(HdrHistogram &histogram : trace->histograms){
+            histogram.reset();
+        }
+        trace->epoch.store(epoch, std::memory_order_release);
+    }
+    trace->histograms[kDispatch].record(span.callbackUs - span.receiveUs);
+    if(span.sentUs > 0){
+        trace->histograms[kHandler].record(span.sentUs - span.callbackUs);
+        trace->histograms[kFlush].record(span.doneUs - span.sentUs);
+    }
+    trace->histograms[kTotal].record(std::max(span.doneUs, span.callbackEndUs) - span.receiveUs);
+
+    std::unique_lock<std::mutex> lock(trace->mutex);
+    if(trace->spans.size() < maxSpansPerThread_.load(std::memory_order_relaxed)){
+        trace->spans.push_back(span);
+    }
+    else{
+        ++trace->dropped;
+    }
+}
+
+HdrHistogram Tracer::histogram(Stage stage){
+    HdrHistogram merged;
+    uint64_t epoch = g_resetEpoch.load(std::memory_order_acquire);
+    for(const std::shared_ptr<ThreadTrace> &trace : allThreads()){
+        // reset之后还没有再记录过的线程,直方图里只有旧数据
+        if(trace->epoch.load(std::memory_order_acquire) != epoch){
+            continue;
+        }
+        merged.merge(trace->histograms[stage]);
+    }
+    return merged;
+}
+
+const char *Tracer::stageName(Stage stage){
+    static const char *names[kNumStages] = {"dispatch", "handler", "flush", "total"};
+    return stage < kNumStages ? names[stage] : "unknown";
+}
+
+size_t Tracer::droppedSpans(){
+    size_t dropped = 0;
+    for(const std::shared_ptr<ThreadTrace> &trace : allThreads()){
+        std::unique_lock<std::mutex> lock(trace->mutex);
+        dropped += trace->dropped;
+    }
+    return dropped;
+}
+
+// 直方图是单写者的,不能在这里清空正在record的线程的直方图,只递增纪元由各线程自己清空
+void Tracer::reset(){
+    g_resetEpoch.fetch_add(1, std::memory_order_acq_rel);
+    for(const std::shared_ptr<ThreadTrace> &trace : allThreads()){
+        std::unique_lock<std::mutex> lock(trace->mutex);
+        trace->spans.clear();
+        trace->dropped = 0;
+    }
+}
+
+/**
+ * 每个span导出为同一线程上嵌套的完整事件(ph为X):
+ *   request  [receive, 全部写完或回调返回]
+ *     dispatch [receive, callback]   handler [callback, callbackEnd]   flush [callbackEnd, done]
+ * 第一次发送可能发生在回调之中,所以flush从回调返回算起以保证嵌套; 直方图中的kFlush仍从第一次发送算起
+ */
+bool Tracer::writeChromeTrace(const std::string &path){
+    FILE *fp = ::fopen(path.c_str(), "w");
+    if(fp == nullptr){
+        LOG_ERROR("Tracer::writeChromeTrace open %s failed \n", path.c_str());
+        return false;
+    }
+    const pid_t pid = ::getpid();
+    std::vector<std::shared_ptr<ThreadTrace>> threads = allThreads();
+
+    // 时间戳减去最早的receive,便于在查看器中阅读
+    int64_t base = LLONG_MAX;
+    for(const std::shared_ptr<ThreadTrace> &trace : threads){
+        std::unique_lock<std::mutex> lock(trace->mutex);
+        for(const TraceSpan &span : trace->spans){
+            base = std::min(base, span.receiveUs);
+        }
+    }
+
+    bool first = true;
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for(const std::shared_ptr<ThreadTrace> &trace : threads){
+        std::unique_lock<std::mutex> lock(trace->mutex);
+        if(trace->spans.empty()){
+            continue;
+        }
+        fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"loop %d\"}}",
+                first ? "" : ",", pid, trace->tid, trace->tid);
+        first = false;
+        for(const TraceSpan &span : trace->spans){
+            int64_t end = std::max(span.doneUs, span.callbackEndUs);
+            writeEvent(fp, &first, "request", pid, trace->tid, span.receiveUs - base, end - span.receiveUs, span.connId);
+            writeEvent(fp, &first, "dispatch", pid, trace->tid, span.receiveUs - base,
+                       span.callbackUs - span.receiveUs, span.connId);
+            writeEvent(fp, &first, "handler", pid, trace->tid, span.callbackUs - base,
+                       span.callbackEndUs - span.callbackUs, span.connId);
+            if(span.doneUs > span.callbackEndUs){
+                writeEvent(fp, &first, "flush", pid, trace->tid, span.callbackEndUs - base,
+                           span.doneUs - span.callbackEndUs, span.connId);
+            }
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    bool ok = ::ferror(fp) == 0;
+    ::fclose(fp);
+    return ok;
+}
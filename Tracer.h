@@ -0,0 +1,67 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "HdrHistogram.h"
+
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+// 一个被采样请求在服务端的时间线,单位为微秒(与Timestamp一致),尚未发生的时刻为0
+struct TraceSpan{
+    int64_t connId;
+    int64_t receiveUs;     // poll返回(receiveTime)
+    int64_t callbackUs;    // 开始执行messageCallback
+    int64_t callbackEndUs; // messageCallback返回
+    int64_t sentUs;        // 第一次write/writev系统调用返回
+    int64_t doneUs;        // 待发送数据全部写进内核(writeComplete的时刻)
+};
+
+/**
+ * 采样式请求追踪: TcpConnection按采样率为到达的请求记录TraceSpan,写完响应时交给Tracer
+ *   每个线程有自己的一组直方图(分发延迟、处理到发送、发送到写完、全程),只由本线程写入,查询时合并
+ *   每个线程保留最近记录的span,writeChromeTrace导出为Chrome trace-event JSON
+ *   (chrome://tracing或ui.perfetto.dev打开,每个loop线程一条时间线)
+ * 关闭采样(默认)时连接上只多一次原子读,不取时间也不分配内存
+ */
+class Tracer : noncopyable{
+public:
+    enum Stage{
+        kDispatch, // receiveTime -> messageCallback
+        kHandler,  // messageCallback -> 第一次发送系统调用
+        kFlush,    // 第一次发送 -> 全部写进内核
+        kTotal,    // receiveTime -> 全部写进内核
+        kNumStages
+    };
+
+    // 每oneInN个请求采样一个,0关闭. 可在任意线程调用
+    static void setSampling(int oneInN) { sampling_.store(oneInN < 0 ? 0 : oneInN, std::memory_order_relaxed); }
+    static int sampling() { return sampling_.load(std::memory_order_relaxed); }
+    static bool enabled() { return sampling() > 0; }
+    // 调用线程上的下一个请求是否采样,需先判断enabled()
+    static bool sample();
+
+    // 超过这个时间还没写完响应的span(回调没有发送数据)在连接收到下一个请求时丢弃,不计入直方图
+    static const int64_t kMaxSpanAgeUs = 10 * 1000 * 1000;
+
+    // 记录一个完成的span,在产生它的loop线程中调用
+    static void record(const TraceSpan &span);
+
+    // 合并所有线程的直方图
+    static HdrHistogram histogram(Stage stage);
+    static const char *stageName(Stage stage);
+    // 每个线程最多保留的span数,超出后丢弃新的span(直方图照常记录)
+    static void setMaxSpansPerThread(size_t maxSpans) { maxSpansPerThread_.store(maxSpans, std::memory_order_relaxed); }
+    static size_t droppedSpans();
+    // 清空所有线程的直方图与span,可在任意线程调用.
+    // span立即清空; 直方图由各loop线程在下一次record时清空,在此之前histogram()不合并该线程
+    static void reset();
+
+    // 导出所有线程保留的span,成功返回true
+    static bool writeChromeTrace(const std::string &path);
+
+private:
+    static std::atomic<int> sampling_;
+    static std::atomic<size_t> maxSpansPerThread_;
+};
@@ -0,0 +1,326 @@
+#include "TrafficRecorder.h"
+#include "InetAddress.h"
+#include "Thread.h"
+#include "logger.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+std::atomic<bool> TrafficRecorder::recording_(false);
+
+namespace{
+
+const char kMagic[8] = {'M', 'M', 'C', 'A', 'P', '0', '0', '1'};
+const size_t kBufferSize = 4 * 1024 * 1024;
+const size_t kMaxPendingBuffers = 16; // 后台线程积压超过这么多缓冲区后开始丢弃
+const int kFlushIntervalSeconds = 1;
+
+void appendVarint(std::string *buf, uint64_t value){
+    while(value >= 0x80){
+        buf->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    buf->push_back(static_cast<char>(value));
+}
+
+bool readVarint(const char **p, const char *end, uint64_t *value){
+    uint64_t result = 0;
+    for(int shift = 0; shift < 64 && *p < end; shift += 7){
+        uint8_t byte = static_cast<uint8_t>(*(*p)++);
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0){
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+using BufferPtr = std::unique_ptr<std::string>;
+
+// 编码记录并由后台线程写入文件. 进程内只有一个实例,start/stop之间复用
+class CaptureWriter{
+public:
+    CaptureWriter() : fp_(nullptr), lastTimeUs_(0), generation_(0), nextConnId_(1), dropped_(0), running_(false), outboundData_(false) {}
+
+    bool start(const std::string &path, bool outboundData){
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(fp_ != nullptr){
+            return false;
+        }
+        fp_ = ::fopen(path.c_str(), "wb");
+        if(fp_ == nullptr){
+            LOG_ERROR("TrafficRecorder::start open %s failed \n", path.c_str());
+            return false;
+        }
+        ::fwrite(kMagic, 1, sizeof(kMagic), fp_);
+        current_.reset(new std::string);
+        current_->reserve(kBufferSize);
+        lastTimeUs_ = 0;
+        ++generation_;
+        nextConnId_ = 1;
+        dropped_ = 0;
+        running_ = true;
+        outboundData_ = outboundData;
+        thread_.reset(new Thread(std::bind(&CaptureWriter::threadFunc, this), "TrafficRecorder"));
+        thread_->start();
+        return true;
+    }
+
+    void stop(){
+        std::unique_ptr<Thread> thread;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(!running_){
+                return;
+            }
+            running_ = false;
+            if(!current_->empty()){
+                full_.push_back(std::move(current_));
+            }
+            thread = std::move(thread_);
+        }
+        cond_.notify_one();
+        thread->join(); // 后台线程写完剩余缓冲区后关闭文件
+    }
+
+    int64_t open(const std::string &peer){
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(!running_){
+            return 0;
+        }
+        int64_t connId = nextConnId_++;
+        appendLocked(TrafficRecorder::kOpen, connId, Timestamp::now().microSecondsSinceEpoch(), peer.data(), peer.size());
+        return (generation_ << kGenerationShift) | connId;
+    }
+
+    void append(TrafficRecorder::RecordType type, int64_t connId, int64_t timeUs, const struct iovec *iov, int iovcnt){
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 之前某次录制中建立的连接,本次文件中没有它的建立记录
+        if(!running_ || (connId >> kGenerationShift) != generation_){
+            return;
+        }
+        connId &= (int64_t(1) << kGenerationShift) - 1;
+        size_t len = 0;
+        for(int i = 0; i < iovcnt; ++i){
+            len += iov[i].iov_len;
+        }
+        if(type == TrafficRecorder::kOutbound && !outboundData_){
+            if(reserveLocked(0)){
+                encodeHeaderLocked(TrafficRecorder::kOutboundLength, connId, timeUs, len);
+            }
+            return;
+        }
+        if(!reserveLocked(len)){
+            return;
+        }
+        encodeHeaderLocked(type, connId, timeUs, len);
+        for(int i = 0; i < iovcnt; ++i){
+            current_->append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+    }
+
+    void appendLocked(TrafficRecorder::RecordType type, int64_t connId, int64_t timeUs, const char *data, size_t len){
+        if(!reserveLocked(len)){
+            return;
+        }
+        encodeHeaderLocked(type, connId, timeUs, len);
+        current_->append(data, len);
+    }
+
+    int64_t dropped(){
+        std::unique_lock<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    static const size_t kMaxHeaderSize = 1 + 10 + 10 + 10;
+    // open返回的连接号高位是第几次录制(generation_),stop/start之后旧连接的记录不会混进新文件
+    static const int kGenerationShift = 32;
+
+    // 保证当前缓冲区能放下一条记录; 积压过多时丢弃这条记录
+    bool reserveLocked(size_t len){
+        if(current_->size() + kMaxHeaderSize + len <= kBufferSize || current_->empty()){
+            return true;
+        }
+        if(full_.size() >= kMaxPendingBuffers){
+            dropped_ += len;
+            return false;
+        }
+        full_.push_back(std::move(current_));
+        if(!spare_.empty()){
+            current_ = std::move(spare_.back());
+            spare_.pop_back();
+        }
+        else{
+            current_.reset(new std::string);
+            current_->reserve(kBufferSize);
+        }
+        cond_.notify_one();
+        return true;
+    }
+
+    // 时间用与上一条记录的差值编码,记录按追加的顺序写入,差值通常只占1~2字节
+    void encodeHeaderLocked(TrafficRecorder::RecordType type, int64_t connId, int64_t timeUs, size_t len){
+        current_->push_back(static_cast<char>(type));
+        appendVarint(current_.get(), static_cast<uint64_t>(connId));
+        appendVarint(current_.get(), zigzag(timeUs - lastTimeUs_));
+        appendVarint(current_.get(), len);
+        lastTimeUs_ = timeUs;
+    }
+
+    void threadFunc(){
+        std::vector<BufferPtr> toWrite;
+        FILE *fp = nullptr;
+        for(;;){
+            bool running;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if(full_.empty() && running_){
+                    cond_.wait_for(lock, std::chrono::seconds(kFlushIntervalSeconds));
+                }
+                // 定时把没写满的当前缓冲区也交出来,录制中途查看文件时数据不会太旧
+                if(running_ && full_.empty() && !current_->empty()){
+                    full_.push_back(std::move(current_));
+                    current_.reset(new std::string);
+                    current_->reserve(kBufferSize);
+                }
+                toWrite.swap(full_);
+                fp = fp_;
+                running = running_;
+            }
+            for(BufferPtr &buffer : toWrite){
+                ::fwrite(buffer->data(), 1, buffer->size(), fp);
+            }
+            ::fflush(fp);
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for(BufferPtr &buffer : toWrite){
+                    if(spare_.size() < 2){
+                        buffer->clear();
+                        spare_.push_back(std::move(buffer));
+                    }
+                }
+            }
+            toWrite.clear();
+            if(!running){
+                std::unique_lock<std::mutex> lock(mutex_);
+                if(full_.empty()){
+                    ::fclose(fp_);
+                    fp_ = nullptr;
+                    current_.reset();
+                    spare_.clear();
+                    return;
+                }
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    FILE *fp_; // 只由后台线程写入,start/stop时在锁内切换
+    BufferPtr current_;
+    std::vector<BufferPtr> full_;
+    std::vector<BufferPtr> spare_;
+    int64_t lastTimeUs_;
+    int64_t generation_; // start的次数
+    int64_t nextConnId_; // 文件中的连接号,每次录制从1开始
+    int64_t dropped_;
+    bool running_;
+    bool outboundData_; // 是否记录发送的数据,否则只记长度
+    std::unique_ptr<Thread> thread_;
+};
+
+CaptureWriter &writer(){
+    static CaptureWriter instance;
+    return instance;
+}
+
+} // namespace
+
+bool TrafficRecorder::start(const std::string &path, bool recordOutboundData){
+    if(!writer().start(path, recordOutboundData)){
+        return false;
+    }
+    recording_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void TrafficRecorder::stop(){
+    recording_.store(false, std::memory_order_relaxed);
+    writer().stop();
+}
+
+int64_t TrafficRecorder::droppedBytes(){
+    return writer().dropped();
+}
+
+int64_t TrafficRecorder::open(const InetAddress &peerAddr){
+    return writer().open(peerAddr.toIpPort());
+}
+
+void TrafficRecorder::inbound(int64_t connId, Timestamp receiveTime, const char *data, size_t len){
+    struct iovec iov;
+    iov.iov_base = const_cast<char *>(data);
+    iov.iov_len = len;
+    writer().append(kInbound, connId, receiveTime.microSecondsSinceEpoch(), &iov, 1);
+}
+
+void TrafficRecorder::outbound(int64_t connId, const struct iovec *iov, int iovcnt){
+    writer().append(kOutbound, connId, Timestamp::now().microSecondsSinceEpoch(), iov, iovcnt);
+}
+
+void TrafficRecorder::close(int64_t connId){
+    writer().append(kClose, connId, Timestamp::now().microSecondsSinceEpoch(), nullptr, 0);
+}
+
+bool TrafficRecorder::load(const std::string &path, std::vector<Record> *records){
+    FILE *fp = ::fopen(path.c_str(), "rb");
+    if(fp == nullptr){
+        return false;
+    }
+    std::string content;
+    char buf[65536];
+    size_t n;
+    while((n = ::fread(buf, 1, sizeof(buf), fp)) > 0){
+        content.append(buf, n);
+    }
+    ::fclose(fp);
+    if(content.size() < sizeof(kMagic) || ::memcmp(content.data(), kMagic, sizeof(kMagic)) != 0){
+        return false;
+    }
+    const char *p = content.data() + sizeof(kMagic);
+    const char *end = content.data() + content.size();
+    int64_t timeUs = 0;
+    while(p < end){
+        Record record;
+        uint8_t type = static_cast<uint8_t>(*p++);
+        uint64_t connId, delta, len;
+        if(type < kOpen || type > kOutboundLength || !readVarint(&p, end, &connId) || !readVarint(&p, end, &delta)
+           || !readVarint(&p, end, &len)){
+            return false;
+        }
+        // 只记长度的记录没有数据部分
+        size_t dataLen = type == kOutboundLength ? 0 : len;
+        if(dataLen > static_cast<size_t>(end - p)){
+            return false;
+        }
+        timeUs += unzigzag(delta);
+        record.type = static_cast<RecordType>(type);
+        record.connId = static_cast<int64_t>(connId);
+        record.timeUs = timeUs;
+        record.length = len;
+        record.data.assign(p, dataLen);
+        p += dataLen;
+        records->push_back(std::move(record));
+    }
+    return true;
+}
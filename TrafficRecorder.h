@@ -0,0 +1,66 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/uio.h>
+
+class InetAddress;
+
+/**
+ * 流量录制: 开启后TcpConnection把每个连接的建立、收到的数据、发送的数据与关闭
+ * 连同微秒时间戳写进一个紧凑的二进制文件,供example/replay按原始节奏或全速回放
+ *
+ * 文件格式: 8字节魔数"MMCAP001",之后是连续的记录
+ *   类型(1字节) 连接号(varint) 与上一条记录的时间差(zigzag varint,微秒) 数据长度(varint) 数据
+ * 建立记录的数据为对端地址; TLS连接记录的是明文
+ * 回放只需要响应的长度,默认发送的数据只记长度(kOutboundLength,没有数据部分),文件与开销都小得多
+ *
+ * 记录在调用线程中编码进当前缓冲区(加锁,只做一次拷贝),写满的缓冲区由后台线程写入文件
+ * (与muduo的AsyncLogging相同的双缓冲). 后台线程跟不上时丢弃记录并计数,不阻塞io线程
+ * 未开启录制时,TcpConnection只在连接建立时读一次原子变量
+ */
+class TrafficRecorder : noncopyable{
+public:
+    enum RecordType : uint8_t{
+        kOpen = 1,
+        kInbound,  // 对端发来的数据
+        kOutbound, // 本端发送的数据
+        kClose,
+        kOutboundLength, // 只记录长度的发送数据
+    };
+
+    struct Record{
+        RecordType type;
+        int64_t connId;
+        int64_t timeUs; // 微秒,与Timestamp相同
+        size_t length;  // 数据的字节数, kOutboundLength记录没有data
+        std::string data;
+    };
+
+    // 开始录制到path(覆盖已有文件),已在录制或打开失败时返回false
+    // recordOutboundData为false时发送的数据只记长度
+    static bool start(const std::string &path, bool recordOutboundData = false);
+    // 写出缓冲区中的全部记录并关闭文件; 之后到达的记录被忽略
+    static void stop();
+    static bool recording() { return recording_.load(std::memory_order_relaxed); }
+    // 因后台写入跟不上而丢弃的字节数
+    static int64_t droppedBytes();
+
+    // 由TcpConnection调用. open返回本次录制中的连接号,未在录制时返回0
+    // 连接号只对本次录制有效,stop后再start,之前的连接号的记录被忽略
+    static int64_t open(const InetAddress &peerAddr);
+    static void inbound(int64_t connId, Timestamp receiveTime, const char *data, size_t len);
+    static void outbound(int64_t connId, const struct iovec *iov, int iovcnt);
+    static void close(int64_t connId);
+
+    // 读取录制文件,格式错误时返回false(已读出的记录保留在records中)
+    static bool load(const std::string &path, std::vector<Record> *records);
+
+private:
+    static std::atomic<bool> recording_;
+};
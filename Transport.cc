@@ -0,0 +1,27 @@
+#include "Transport.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+void Transport::clearDoorbell(){
+    uint64_t count;
+    ::read(doorbellFd_, &count, sizeof(count));
+}
+
+void Transport::ring(int doorbellFd){
+    uint64_t one = 1;
+    if(::write(doorbellFd, &one, sizeof(one)) != sizeof(one)){
+        LOG_ERROR("Transport::ring fd=%d error:%d \n", doorbellFd, errno);
+    }
+}
+
+int Transport::createDoorbell(){
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(fd < 0){
+        LOG_FATAL("Transport::createDoorbell eventfd error:%d \n", errno);
+    }
+    return fd;
+}
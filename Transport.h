@@ -0,0 +1,51 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <memory>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+class Buffer;
+
+/**
+ * TcpConnection的字节流传输. 连接默认直接读写socket; 设置了Transport的连接改为通过它收发数据,
+ * 用户的回调、Buffer以及Poller都不受影响
+ *
+ * fd()是一个eventfd门铃,在Poller中只注册读事件: 对端写入了数据、关闭了写端或者腾出了发送空间时
+ * 敲响门铃,TcpConnection被唤醒后用readable/writable分别检查. 门铃由TcpConnection的Socket负责关闭
+ * 除构造与析构外只在所属连接的loop线程中调用
+ */
+class Transport : noncopyable{
+public:
+    explicit Transport(int doorbellFd) : doorbellFd_(doorbellFd) {}
+    virtual ~Transport() = default;
+
+    int fd() const { return doorbellFd_; }
+
+    // 有数据可读,或对端已关闭写端(read会返回0)
+    virtual bool readable() const = 0;
+    // 有发送空间,或对端已关闭(write会失败)
+    virtual bool writable() const = 0;
+    // 读取至多maxBytes字节(0为不限制)追加到buf. 返回0表示对端已关闭写端;
+    // 没有数据时返回-1,*savedErrno为EAGAIN
+    virtual ssize_t read(Buffer *buf, size_t maxBytes, int *savedErrno) = 0;
+    // 与writev相同: 写入尽量多的数据,一个字节都写不下时返回-1且errno为EWOULDBLOCK,
+    // 之后对端腾出空间时敲响门铃; 对端已关闭时errno为EPIPE
+    virtual ssize_t write(const struct iovec *iov, int iovcnt) = 0;
+    virtual void shutdownWrite() = 0;
+
+    // 取走门铃上累计的通知
+    void clearDoorbell();
+    // 敲自己的门铃,让所属loop重新检查(恢复读时积压的数据不会再有新的通知)
+    void ring() { ring(doorbellFd_); }
+
+protected:
+    static void ring(int doorbellFd);
+    static int createDoorbell();
+
+private:
+    const int doorbellFd_;
+};
+
+using TransportPtr = std::unique_ptr<Transport>;
@@ -0,0 +1,274 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "logger.h"
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+
+static int createNonblockingUdp(){
+    int sockfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(sockfd < 0){
+        LOG_FATAL("%s:%s:%d udp socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+// 一次可读事件最多收几批,避免一个高速UDP socket独占loop
+static const int kMaxBatchesPerEvent = 16;
+// GSO一次发送最多合并的段数与总长度
+static const int kMaxGsoSegments = 64;
+static const size_t kMaxGsoBytes = 65000;
+static const size_t kGroSlotSize = 65535;
+static const size_t kControlSize = CMSG_SPACE(sizeof(int));
+
+UdpServer::UdpServer(EventLoop *loop,
+                     const InetAddress &listenAddr,
+                     const std::string &name,
+                     int batchSize,
+                     size_t maxDatagramSize)
+    : loop_(loop)
+    , name_(name)
+    , socket_(createNonblockingUdp())
+    , channel_(loop, socket_.fd())
+    , batchSize_(batchSize)
+    , maxDatagramSize_(maxDatagramSize)
+    , gro_(false)
+    , gso_(false)
+    , recvSlotSize_(maxDatagramSize)
+    , sendBuffer_(batchSize * maxDatagramSize)
+    , sendMsgs_(batchSize)
+    , sendIovecs_(batchSize)
+    , sendAddrs_(batchSize)
+    , sendControl_(batchSize * kControlSize)
+    , pendingSends_(0)
+    , flushQueued_(false)
+    , alive_(std::make_shared<bool>(true))
+{
+    socket_.setReuseAddr(true);
+    socket_.bindAddress(listenAddr);
+    channel_.setReadCallback(std::bind(&UdpServer::handleRead, this, std::placeholders::_1));
+    prepareRecvBatch();
+}
+
+UdpServer::~UdpServer(){
+    flush();
+    alive_.reset();
+    channel_.disableAll();
+    channel_.remove();
+}
+
+bool UdpServer::enableGro(){
+    int on = 1;
+    if(::setsockopt(socket_.fd(), IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) < 0){
+        LOG_ERROR("UdpServer::enableGro [%s] setsockopt UDP_GRO err:%d \n", name_.c_str(), errno);
+        return false;
+    }
+    gro_ = true;
+    recvSlotSize_ = kGroSlotSize; // 合并后的数据报最大64K
+    prepareRecvBatch();
+    return true;
+}
+
+// 预分配接收用的mmsghdr/iovec/地址/控制消息数组,recvmmsg每次复用
+void UdpServer::prepareRecvBatch(){
+    recvBuffer_.assign(batchSize_ * recvSlotSize_, 0);
+    recvMsgs_.assign(batchSize_, mmsghdr());
+    recvIovecs_.assign(batchSize_, iovec());
+    recvAddrs_.assign(batchSize_, sockaddr_in());
+    recvControl_.assign(gro_ ? batchSize_ * kControlSize : 0, 0);
+    packets_.clear();
+    packets_.reserve(gro_ ? batchSize_ * kMaxGsoSegments : batchSize_);
+    for(int i = 0; i < batchSize_; ++i){
+        recvIovecs_[i].iov_base = &recvBuffer_[i * recvSlotSize_];
+        recvIovecs_[i].iov_len = recvSlotSize_;
+    }
+}
+
+void UdpServer::start(){
+    loop_->runInLoop([this](){ channel_.enableReading(); });
+}
+
+InetAddress UdpServer::localAddress() const{
+    sockaddr_in local;
+    bzero(&local, sizeof(local));
+    socklen_t addrlen = sizeof(local);
+    ::getsockname(socket_.fd(), (sockaddr *)&local, &addrlen);
+    return InetAddress(local);
+}
+
+void UdpServer::handleRead(Timestamp receiveTime){
+    for(int round = 0; round < kMaxBatchesPerEvent; ++round){
+        // recvmmsg会改写msg_namelen/msg_controllen,每批都要重置
+        for(int i = 0; i < batchSize_; ++i){
+            msghdr &hdr = recvMsgs_[i].msg_hdr;
+            hdr.msg_name = &recvAddrs_[i];
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_iov = &recvIovecs_[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = gro_ ? &recvControl_[i * kControlSize] : nullptr;
+            hdr.msg_controllen = gro_ ? kControlSize : 0;
+            hdr.msg_flags = 0;
+        }
+        int n = ::recvmmsg(socket_.fd(), &recvMsgs_[0], batchSize_, MSG_DONTWAIT, nullptr);
+        if(n <= 0){
+            if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+                LOG_ERROR("UdpServer::handleRead [%s] recvmmsg err:%d \n", name_.c_str(), errno);
+            }
+            break;
+        }
+
+        packets_.clear();
+        for(int i = 0; i < n; ++i){
+            const char *data = static_cast<const char *>(recvIovecs_[i].iov_base);
+            size_t len = recvMsgs_[i].msg_len;
+            InetAddress peer(recvAddrs_[i]);
+            // 比接收槽位大的数据报只收到了前一部分,不能当作完整的数据交出去
+            if(recvMsgs_[i].msg_hdr.msg_flags & MSG_TRUNC){
+                LOG_ERROR("UdpServer::handleRead [%s] drop truncated datagram from %s, slot size %zu \n",
+                          name_.c_str(), peer.toIpPort().c_str(), recvSlotSize_);
+                continue;
+            }
+            size_t segment = len;
+            if(gro_){ // 内核合并的数据报按UDP_GRO给出的段长拆开
+                msghdr &hdr = recvMsgs_[i].msg_hdr;
+                for(cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)){
+                    if(cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO){
+                        int gsoSize = 0;
+                        ::memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof(gsoSize));
+                        if(gsoSize > 0){
+                            segment = gsoSize;
+                        }
+                    }
+                }
+            }
+            for(size_t offset = 0; offset < len; offset += segment){
+                packets_.push_back(UdpPacket{data + offset, std::min(segment, len - offset), peer});
+            }
+            if(len == 0){ // 空数据报
+                packets_.push_back(UdpPacket{data, 0, peer});
+            }
+        }
+        if(batchCallback_ && !packets_.empty()){
+            batchCallback_(this, &packets_[0], static_cast<int>(packets_.size()), receiveTime);
+        }
+        if(n < batchSize_){ // socket已读空
+            break;
+        }
+    }
+}
+
+void UdpServer::send(const InetAddress &peer, const char *data, size_t len){
+    if(loop_->isInLoopThread()){
+        sendInLoop(peer, data, len);
+    }
+    else{
+        std::weak_ptr<bool> alive(alive_);
+        std::string message(data, len);
+        loop_->runInLoop([this, alive, peer, message](){
+            if(alive.lock()){
+                sendStringInLoop(peer, message);
+            }
+        });
+    }
+}
+
+void UdpServer::sendStringInLoop(const InetAddress &peer, const std::string &message){
+    sendInLoop(peer, message.data(), message.size());
+}
+
+void UdpServer::sendInLoop(const InetAddress &peer, const char *data, size_t len){
+    if(len > maxDatagramSize_){ // 放不进发送批次的槽位,直接发送
+        flush();
+        if(::sendto(socket_.fd(), data, len, 0, peer.getSockAddr(), peer.getSockLen()) < 0){
+            LOG_ERROR("UdpServer::sendInLoop [%s] sendto err:%d \n", name_.c_str(), errno);
+        }
+        return;
+    }
+    int slot = pendingSends_++;
+    char *buf = &sendBuffer_[slot * maxDatagramSize_];
+    ::memcpy(buf, data, len);
+    sendIovecs_[slot].iov_base = buf;
+    sendIovecs_[slot].iov_len = len;
+    sendAddrs_[slot] = *peer.getSockAddrInet();
+
+    if(pendingSends_ == batchSize_){
+        flush();
+    }
+    else if(!flushQueued_){ // 本轮事件处理完后再统一发出
+        flushQueued_ = true;
+        std::weak_ptr<bool> alive(alive_);
+        loop_->queueInLoop([this, alive](){
+            if(alive.lock()){
+                flushQueued_ = false;
+                flush();
+            }
+        });
+    }
+}
+
+static bool sameAddr(const sockaddr_in &a, const sockaddr_in &b){
+    return a.sin_port == b.sin_port && a.sin_addr.s_addr == b.sin_addr.s_addr;
+}
+
+void UdpServer::flush(){
+    if(pendingSends_ == 0){
+        return;
+    }
+    // 组装mmsghdr: 槽位的iovec是连续的,GSO合并相邻的数据报只需增大msg_iovlen
+    int msgs = 0;
+    for(int i = 0; i < pendingSends_; ){
+        msghdr &hdr = sendMsgs_[msgs].msg_hdr;
+        bzero(&hdr, sizeof(hdr));
+        hdr.msg_name = &sendAddrs_[i];
+        hdr.msg_namelen = sizeof(sockaddr_in);
+        hdr.msg_iov = &sendIovecs_[i];
+        int count = 1;
+        if(gso_){
+            size_t segment = sendIovecs_[i].iov_len;
+            size_t total = segment;
+            // 同一目的地、段长相同的数据报合并,最后一个可以更短
+            while(i + count < pendingSends_
+                  && count < kMaxGsoSegments
+                  && sameAddr(sendAddrs_[i + count], sendAddrs_[i])
+                  && sendIovecs_[i + count - 1].iov_len == segment
+                  && sendIovecs_[i + count].iov_len <= segment
+                  && segment > 0
+                  && total + sendIovecs_[i + count].iov_len <= kMaxGsoBytes){
+                total += sendIovecs_[i + count].iov_len;
+                ++count;
+            }
+            if(count > 1){
+                hdr.msg_control = &sendControl_[msgs * kControlSize];
+                hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = IPPROTO_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gsoSize = static_cast<uint16_t>(segment);
+                ::memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+            }
+        }
+        hdr.msg_iovlen = count;
+        i += count;
+        ++msgs;
+    }
+
+    int sent = 0;
+    while(sent < msgs){
+        int n = ::sendmmsg(socket_.fd(), &sendMsgs_[sent], msgs - sent, MSG_DONTWAIT);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            // 发送缓冲区满时丢弃剩余数据报(UDP不保证送达)
+            LOG_ERROR("UdpServer::flush [%s] sendmmsg err:%d, drop %d messages \n", name_.c_str(), errno, msgs - sent);
+            break;
+        }
+        sent += n;
+    }
+    pendingSends_ = 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Socket.h"
+#include "Channel.h"
+#include "Timestamp.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+
+class EventLoop;
+
+// 一个收到的数据报,data指向UdpServer预分配的接收缓冲区,仅在BatchCallback期间有效
+struct UdpPacket{
+    const char *data;
+    size_t len;
+    InetAddress peer;
+};
+
+/**
+ * UDP收发,注册为loop上的一个Channel
+ * 接收: 可读时用recvmmsg一次收一批数据报到预分配的数组,整批交给BatchCallback; 超过槽位被截断的数据报丢弃
+ * 发送: loop线程内的send先放入发送批次,本轮事件处理完后(pendingFunctors阶段)用sendmmsg一次发出,批次满时立即发出
+ *       析构时发出剩余的批次; 需在loop线程中析构
+ * 可选GRO(内核合并同一流的数据报,接收时按段拆开)与GSO(相邻的同目的地、同长度数据报合并为一次发送)
+ */
+class UdpServer : noncopyable {
+public:
+    using BatchCallback = std::function<void(UdpServer *, const UdpPacket *packets, int count, Timestamp receiveTime)>;
+
+    static const int kDefaultBatchSize = 64;
+    static const size_t kDefaultMaxDatagramSize = 2048;
+
+    UdpServer(EventLoop *loop,
+              const InetAddress &listenAddr,
+              const std::string &name,
+              int batchSize = kDefaultBatchSize,
+              size_t maxDatagramSize = kDefaultMaxDatagramSize);
+    ~UdpServer();
+
+    void setBatchCallback(const BatchCallback &cb) { batchCallback_ = cb; }
+
+    // 需在start之前调用,内核不支持时返回false
+    bool enableGro();
+    void enableGso() { gso_ = true; }
+
+    void start();
+
+    // 可在任意线程调用
+    void send(const InetAddress &peer, const char *data, size_t len);
+    // 立即发出当前批次,只能在loop线程调用
+    void flush();
+
+    EventLoop *getLoop() const { return loop_; }
+    const std::string &name() const { return name_; }
+    InetAddress localAddress() const;
+
+private:
+    void handleRead(Timestamp receiveTime);
+    void sendInLoop(const InetAddress &peer, const char *data, size_t len);
+    void sendStringInLoop(const InetAddress &peer, const std::string &message);
+    void prepareRecvBatch();
+
+    EventLoop *loop_;
+    const std::string name_;
+    Socket socket_;
+    Channel channel_;
+    BatchCallback batchCallback_;
+    const int batchSize_;
+    const size_t maxDatagramSize_;
+    bool gro_;
+    bool gso_;
+
+    // 接收批次, 在构造(或enableGro)时分配好,之后不再分配
+    size_t recvSlotSize_;
+    std::vector<char> recvBuffer_;
+    std::vector<mmsghdr> recvMsgs_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_in> recvAddrs_;
+    std::vector<char> recvControl_;
+    std::vector<UdpPacket> packets_;
+
+    // 发送批次, 只在loop线程访问
+    std::vector<char> sendBuffer_;
+    std::vector<mmsghdr> sendMsgs_;
+    std::vector<iovec> sendIovecs_;
+    std::vector<sockaddr_in> sendAddrs_;
+    std::vector<char> sendControl_;
+    int pendingSends_;
+    bool flushQueued_;
+    // queueInLoop/runInLoop的回调持有它的weak_ptr,UdpServer析构后不再访问this
+    std::shared_ptr<bool> alive_;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <malloc.h>
+#include <stdlib.h>
+
+/**
+ * 替换全局operator new/delete,统计进程内的堆分配,供各bench使用
+ *   g_allocs: 分配次数   g_allocBytes: 累计申请的字节数   g_liveBytes: 当前未释放的字节数(按malloc_usable_size)
+ * 定义了替换函数与计数器,一个程序只能在一个源文件中包含
+ */
+
+static std::atomic<long> g_allocs(0);
+static std::atomic<long> g_allocBytes(0);
+static std::atomic<long> g_liveBytes(0);
+
+// 替换的new/delete都不内联: 内联进调用者后GCC看到的是malloc/free,会与调用者中的new/delete配对,
+// 误报-Wmismatched-new-delete
+__attribute__((noinline)) void *operator new(size_t size){
+    void *p = malloc(size);
+    if(!p){
+        throw std::bad_alloc();
+    }
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    g_liveBytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    return p;
+}
+
+// 数组形式也替换,new[]出来的内存同样计数并由下面的delete[]释放
+void *operator new[](size_t size){
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept{
+    if(p){
+        g_liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        free(p);
+    }
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept{
+    operator delete(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) noexcept{
+    operator delete(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept{
+    operator delete(p);
+}
@@ -0,0 +1,178 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/BroadcastGroup.h>
+#include <mymuduo/logger.h>
+#include "AllocCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 把1KB消息扇出给大量订阅者,比较逐个连接send(std::string)与BroadcastGroup
+ * 发布线程不是io线程: 逐个send时每个连接都要拷贝一份消息投递到它的loop
+ * 统计服务端进程每条送达消息的堆分配次数与字节数(AllocCounter.h)
+ * 订阅者在fork出的子进程中,两个进程各自只占一半的fd
+ * 用法: ./broadcastbench [订阅者数] [消息数] [io线程数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t kMessageSize = 1024;
+
+static const int kBatch = 100; // 每批建立的连接数,小于listen的backlog
+
+static bool readByte(int fd){
+    char c;
+    return ::read(fd, &c, 1) == 1;
+}
+
+static bool writeByte(int fd){
+    char c = 'x';
+    return ::write(fd, &c, 1) == 1;
+}
+
+// 子进程: 收到父进程的许可后建立一批订阅连接; 之后每收完一轮的数据通知父进程一次
+static void runSubscribers(int subscribers, int messages, int rounds, int fromParent, int toParent){
+    sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(9023);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int epfd = ::epoll_create1(0);
+    for(int i = 0; i < subscribers; ++i){
+        if(i % kBatch == 0 && ((i > 0 && !writeByte(toParent)) || !readByte(fromParent))){
+            _exit(1);
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0){
+            perror("connect");
+            _exit(1);
+        }
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    if(!writeByte(toParent)){
+        _exit(1);
+    }
+
+    const size_t perRound = static_cast<size_t>(subscribers) * messages * kMessageSize;
+    static char buf[65536];
+    epoll_event events[256];
+    for(int round = 0; round < rounds; ++round){
+        size_t received = 0;
+        while(received < perRound){
+            int n = ::epoll_wait(epfd, events, 256, 1000);
+            for(int i = 0; i < n; ++i){
+                ssize_t len = ::recv(events[i].data.fd, buf, sizeof(buf), MSG_DONTWAIT);
+                if(len > 0){
+                    received += len;
+                }
+            }
+        }
+        if(!writeByte(toParent)){
+            _exit(1);
+        }
+    }
+    _exit(0);
+}
+
+int main(int argc, char *argv[]){
+    int subscribers = argc > 1 ? atoi(argv[1]) : 10000;
+    int messages = argc > 2 ? atoi(argv[2]) : 50;
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+    const int rounds = 2;
+
+    // 在创建任何线程之前fork
+    int toChild[2];
+    int toParent[2];
+    if(::pipe(toChild) < 0 || ::pipe(toParent) < 0){
+        perror("pipe");
+        return 1;
+    }
+    pid_t child = ::fork();
+    if(child == 0){
+        runSubscribers(subscribers, messages, rounds, toChild[0], toParent[1]);
+    }
+
+    // 连接回调引用group与conns,它们要比server活得久
+    BroadcastGroup group;
+    std::mutex mutex;
+    std::vector<TcpConnectionPtr> conns;
+    EventLoop loop;
+    InetAddress addr(9023);
+    TcpServer server(&loop, addr, "broadcast");
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            group.add(conn);
+            std::unique_lock<std::mutex> lock(mutex);
+            conns.push_back(conn);
+        }
+        else{
+            group.remove(conn);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp){ buf->retrieveAll(); });
+    server.setThreadNum(threads);
+    server.start();
+
+    std::thread publisher([&](){
+        // 一批连接全部被accept后再允许子进程建立下一批
+        for(int connected = 0; connected < subscribers; connected += kBatch){
+            if(!writeByte(toChild[1]) || !readByte(toParent[0])){
+                return;
+            }
+            while(group.size() < static_cast<size_t>(std::min(connected + kBatch, subscribers))){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        const std::string message(kMessageSize, 'm');
+        for(int round = 0; round < rounds; ++round){
+            bool useGroup = round == 1;
+            long allocs = g_allocs.load();
+            long bytes = g_allocBytes.load();
+            Clock::time_point start = Clock::now();
+            for(int i = 0; i < messages; ++i){
+                if(useGroup){
+                    group.send(std::make_shared<const std::string>(message));
+                }
+                else{
+                    for(const TcpConnectionPtr &conn : conns){
+                        conn->send(message);
+                    }
+                }
+            }
+            double publishSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if(!readByte(toParent[0])){
+                break;
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            double deliveries = static_cast<double>(subscribers) * messages;
+            printf("%-10s %d x %d: publish %7.3f s, delivered in %7.3f s, %9.0f deliveries/s, "
+                   "%5.2f allocs and %6.0f bytes per delivery\n",
+                   useGroup ? "broadcast" : "send", subscribers, messages, publishSeconds, seconds,
+                   deliveries / seconds, (g_allocs.load() - allocs) / deliveries,
+                   (g_allocBytes.load() - bytes) / deliveries);
+            fflush(stdout);
+        }
+        ::waitpid(child, nullptr, 0);
+        loop.quit();
+    });
+
+    loop.loop();
+    publisher.join();
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 比较普通loop与低延迟(忙轮询)loop的回显延迟分布
+ * 客户端每隔gap微秒发送一条64字节消息,并自旋读取回显,因此测得的差异来自服务端的唤醒开销
+ * 服务端io线程与客户端需各占一个CPU核,单核机器上自旋的loop会与客户端争抢CPU,结果没有意义
+ * 用法: ./busypollbench [消息数] [间隔微秒]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static void spinFor(int us){
+    Clock::time_point end = Clock::now() + std::chrono::microseconds(us);
+    while(Clock::now() < end){
+    }
+}
+
+// 返回每条消息的往返耗时(纳秒)
+static std::vector<int64_t> measure(const InetAddress &addr, int count, int gapUs){
+    std::vector<int64_t> samples;
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+        perror("connect");
+        return samples;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    char message[64] = {0};
+    char reply[64];
+    samples.reserve(count);
+    for(int i = 0; i < count; ++i){
+        spinFor(gapUs);
+        Clock::time_point start = Clock::now();
+        if(::write(fd, message, sizeof(message)) != sizeof(message)){
+            break;
+        }
+        size_t got = 0;
+        while(got < sizeof(reply)){
+            ssize_t n = ::recv(fd, reply + got, sizeof(reply) - got, MSG_DONTWAIT);
+            if(n > 0){
+                got += n;
+            }
+            else if(n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)){
+                ::close(fd);
+                return samples;
+            }
+        }
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    ::close(fd);
+    return samples;
+}
+
+static void report(const char *name, std::vector<int64_t> samples){
+    if(samples.empty()){
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&samples](double p){ return samples[static_cast<size_t>(p * (samples.size() - 1))] / 1000.0; };
+    printf("%-10s p50 %7.2f us  p99 %7.2f us  p99.9 %7.2f us\n", name, pct(0.5), pct(0.99), pct(0.999));
+}
+
+int main(int argc, char *argv[]){
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    int gapUs = argc > 2 ? atoi(argv[2]) : 50;
+
+    EventLoop loop;
+    InetAddress normalAddr(9009);
+    InetAddress busyAddr(9010);
+
+    MessageCallback echo = [](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        conn->send(buf);
+    };
+
+    TcpServer normalServer(&loop, normalAddr, "normal-echo");
+    normalServer.setConnectionCallback([](const TcpConnectionPtr &conn){
+        if(conn->connected()) conn->setTcpNoDelay(true);
+    });
+
+    EventLoop *busyLoop = nullptr;
+    TcpServer busyServer(&loop, busyAddr, "busy-echo");
+    busyServer.setThreadInitCallback([&busyLoop](EventLoop *ioLoop){
+        ioLoop->setBusyPolling(true, 200);
+        busyLoop = ioLoop;
+    });
+    busyServer.setConnectionCallback([](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            conn->setTcpNoDelay(true);
+            conn->setBusyPoll(50, true);
+        }
+    });
+
+    for(TcpServer *server : {&normalServer, &busyServer}){
+        server->setMessageCallback(echo);
+        server->setThreadNum(1);
+        server->start();
+    }
+
+    std::thread client([&](){
+        report("normal", measure(normalAddr, count, gapUs));
+        report("busy-poll", measure(busyAddr, count, gapUs));
+        printf("busy-poll loop: spin budget %d us, %ld spin hits, %ld spin misses\n",
+               busyLoop->spinBudgetUs(), (long)busyLoop->spinHits(), (long)busyLoop->spinMisses());
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TrafficRecorder.h>
+#include <mymuduo/logger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * 流量录制的开销: 服务端按请求行"GET <字节数>\r\n"回复相应长度的数据,
+ * 若干客户端线程以随机的响应大小一问一答,比较关闭/开启录制时的吞吐,并留下录制文件供example/replay回放
+ *   ./capturebench [录制文件] [每个客户端的请求数]
+ *   ./capturebench serve        只运行服务端(回放的目标)
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const uint16_t kPort = 9026;
+static const size_t kMaxResponse = 64 * 1024;
+
+static bool writeAll(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::read(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void startServer(TcpServer *server){
+    static const std::string body(kMaxResponse, 'x');
+    server->setConnectionCallback([](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            conn->setTcpNoDelay(true);
+        }
+    });
+    server->setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        const char *crlf;
+        while((crlf = static_cast<const char *>(::memmem(buf->peek(), buf->readableBytes(), "\r\n", 2))) != nullptr){
+            struct iovec iov;
+            iov.iov_base = const_cast<char *>(body.data());
+            iov.iov_len = std::min<size_t>(strtoul(buf->peek() + 4, nullptr, 10), kMaxResponse);
+            buf->retrieve(crlf + 2 - buf->peek());
+            conn->send(&iov, 1);
+        }
+    });
+    server->setThreadNum(2);
+    server->start();
+}
+
+// 响应大小: 多数是小响应,少数是大响应
+static void runClient(int requests, unsigned seed, std::atomic<long> *done){
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0){
+        perror("connect");
+        return;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::mt19937 rng(seed);
+    std::vector<char> response(kMaxResponse);
+    char request[64];
+    for(int i = 0; i < requests; ++i){
+        size_t size = rng() % 10 == 0 ? 4096 + rng() % (kMaxResponse - 4096) : 64 + rng() % 1024;
+        int len = snprintf(request, sizeof(request), "GET %zu\r\n", size);
+        if(!writeAll(fd, request, len) || !readAll(fd, response.data(), size)){
+            break;
+        }
+        done->fetch_add(1, std::memory_order_relaxed);
+    }
+    ::close(fd);
+}
+
+static void runRound(const char *name, int clients, int requests){
+    std::atomic<long> done(0);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for(int i = 0; i < clients; ++i){
+        threads.emplace_back(runClient, requests, 1000 + i, &done);
+    }
+    for(std::thread &thread : threads){
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-14s %8ld requests in %6.3f s: %8.0f req/s\n", name, done.load(), seconds, done.load() / seconds);
+}
+
+int main(int argc, char *argv[]){
+    EventLoop loop;
+    InetAddress addr(kPort);
+    TcpServer server(&loop, addr, "capture");
+    startServer(&server);
+    if(argc > 1 && strcmp(argv[1], "serve") == 0){
+        loop.loop();
+        return 0;
+    }
+
+    std::string path = argc > 1 ? argv[1] : "capture.mmcap";
+    int requests = argc > 2 ? atoi(argv[2]) : 20000;
+    const int clients = 4;
+    std::thread driver([&](){
+        runRound("recording off", clients, requests);
+        if(!TrafficRecorder::start(path)){
+            fprintf(stderr, "cannot record to %s\n", path.c_str());
+            loop.quit();
+            return;
+        }
+        runRound("recording on", clients, requests);
+        // 连接在io线程中关闭,等它们的关闭记录写进去
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        TrafficRecorder::stop();
+        FILE *fp = fopen(path.c_str(), "rb");
+        if(fp){
+            fseek(fp, 0, SEEK_END);
+            printf("wrote %s: %.1f MiB, %ld bytes dropped\n", path.c_str(), ftell(fp) / 1048576.0,
+                   static_cast<long>(TrafficRecorder::droppedBytes()));
+            fclose(fp);
+        }
+        loop.quit();
+    });
+    loop.loop();
+    driver.join();
+    return 0;
+}
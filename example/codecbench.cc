@@ -0,0 +1,111 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/LengthHeaderCodec.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 小消息吞吐测试: 客户端每轮流水线发送一批长度头消息,服务端经LengthHeaderCodec解出每个消息后原样回发
+ * 用法: ./codecbench [消息大小(字节)] [每批消息数] [批数]
+ */
+
+class FrameEchoServer{
+public:
+    FrameEchoServer(EventLoop *loop, const InetAddress &addr)
+        : server_(loop, addr, "FrameEchoServer")
+        , codec_(std::bind(&FrameEchoServer::onFrame, this, std::placeholders::_1,
+                           std::placeholders::_2, std::placeholders::_3, std::placeholders::_4))
+    {
+        server_.setConnectionCallback([](const TcpConnectionPtr &conn){
+            if(conn->connected()){
+                conn->setTcpNoDelay(true);
+            }
+        });
+        server_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_,
+                                             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        server_.setThreadNum(1);
+    }
+
+    void start() { server_.start(); }
+
+private:
+    void onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, Timestamp){
+        codec_.send(conn, data, len);
+    }
+
+    TcpServer server_;
+    LengthHeaderCodec codec_;
+};
+
+static bool writeAll(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::read(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]){
+    size_t frameSize = argc > 1 ? atoi(argv[1]) : 32;
+    int framesPerBatch = argc > 2 ? atoi(argv[2]) : 1000;
+    int batches = argc > 3 ? atoi(argv[3]) : 2000;
+
+    EventLoop loop;
+    InetAddress addr(9002);
+    FrameEchoServer server(&loop, addr);
+    server.start();
+
+    std::thread client([&](){
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+            perror("connect");
+            loop.quit();
+            return;
+        }
+        Buffer batch;
+        std::string payload(frameSize, 'x');
+        for(int i = 0; i < framesPerBatch; ++i){
+            batch.appendInt32(static_cast<int32_t>(frameSize));
+            batch.append(payload.data(), payload.size());
+        }
+        std::string reply(batch.readableBytes(), '\0');
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < batches; ++i){
+            if(!writeAll(fd, batch.peek(), batch.readableBytes()) || !readAll(fd, &reply[0], reply.size())){
+                fprintf(stderr, "connection broken\n");
+                break;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double frames = static_cast<double>(framesPerBatch) * batches;
+        printf("frame size %zu bytes, %.0f frames in %.3f s: %.0f frames/s, %.2f MiB/s\n",
+               frameSize, frames, seconds, frames / seconds,
+               frames * (frameSize + LengthHeaderCodec::kHeaderLen) / seconds / 1024 / 1024);
+        ::close(fd);
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/logger.h>
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 统计每个已建立连接在服务端占用的堆内存与分配次数
+ * 用AllocCounter.h替换全局operator new/delete计数,客户端使用裸socket,不经过operator new
+ * 客户端轮流绑定127.0.0.1~127.0.0.254作为源地址,单个源地址的临时端口不够建立大量连接
+ * 1M连接需要: ulimit -n 2100000, sysctl fs.nr_open/fs.file-max足够大, 以及几GB内存
+ * 用法: ./connmembench [连接数] [io线程数]
+ */
+
+static long rssKb(){
+    FILE *fp = fopen("/proc/self/statm", "r");
+    long pages = 0, resident = 0;
+    if(fp){
+        if(fscanf(fp, "%ld %ld", &pages, &resident) != 2){
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int main(int argc, char *argv[]){
+    long count = argc > 1 ? atol(argv[1]) : 5000;
+    int threads = argc > 2 ? atoi(argv[2]) : 1;
+
+    EventLoop loop;
+    InetAddress addr(9016);
+    TcpServer server(&loop, addr, "connmem");
+    std::atomic<long> established(0);
+    server.setConnectionCallback([&established](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            ++established;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp){
+        buf->retrieveAll();
+    });
+    server.setThreadNum(threads);
+    server.start();
+
+    std::vector<int> fds;
+    fds.reserve(count);
+    std::thread client([&](){
+        // 等待所有loop线程启动、监听开始,再记录基线
+        usleep(100 * 1000);
+        long allocsBefore = g_allocs.load();
+        long bytesBefore = g_liveBytes.load();
+        long rssBefore = rssKb();
+        for(long i = 0; i < count; ++i){
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if(fd < 0){
+                perror("socket");
+                break;
+            }
+            sockaddr_in local = {};
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = htonl(0x7f000001 + static_cast<uint32_t>(i % 254));
+            ::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local));
+            if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+                perror("connect");
+                ::close(fd);
+                break;
+            }
+            fds.push_back(fd);
+        }
+        while(established < static_cast<long>(fds.size())){
+            usleep(10 * 1000);
+        }
+        usleep(100 * 1000);
+        long n = established.load();
+        if(n > 0){
+            printf("%ld connections: %.1f allocations/connection, %.0f heap bytes/connection, %.0f RSS bytes/connection\n",
+                   n,
+                   static_cast<double>(g_allocs.load() - allocsBefore) / n,
+                   static_cast<double>(g_liveBytes.load() - bytesBefore) / n,
+                   (rssKb() - rssBefore) * 1024.0 / n);
+        }
+        for(int fd : fds){
+            ::close(fd);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/LoopLocal.h>
+#include <mymuduo/HdrHistogram.h>
+#include <mymuduo/logger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 连接规模基准: 客户端进程向本地TcpServer建立N个空闲连接,服务端报告
+ *   accept速率与建立全部连接的耗时、客户端connect耗时的分布
+ *   每个连接带来的RSS增长(不含内核中的socket缓冲区)
+ *   各subloop上的连接数(LoopLocal计数,invokeOnAll汇总)
+ *   全部连接空闲时服务端进程的CPU占用
+ * 客户端轮流绑定kSourceAddrs个127.0.1.x源地址,每个源地址各有一套临时端口,突破单个源地址约2.8万的上限;
+ * 客户端通过共享内存读取服务端已accept的连接数,让未accept的连接不超过listen队列长度
+ * 服务端与客户端各在一个进程中,每个进程的fd上限都要大于N(启动时把软上限提升到硬上限)
+ * 用法: ./connscalebench [连接数] [io线程数] [空闲测量秒数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const int kSourceAddrs = 64;
+static const long kMaxInFlight = 100; // 小于listen的backlog(128)
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+// 父子进程共享的计数
+struct Shared{
+    std::atomic<long> accepted;
+    std::atomic<long> closed;
+    std::atomic<bool> listening; // 服务端已开始监听
+    std::atomic<bool> release;   // 服务端测量完成,客户端可以关闭连接
+};
+
+static long rssBytes(){
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if(!fp){
+        return 0;
+    }
+    long pages = 0;
+    long resident = 0;
+    if(fscanf(fp, "%ld %ld", &pages, &resident) != 2){
+        resident = 0;
+    }
+    fclose(fp);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static double cpuSeconds(){
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static long raiseFdLimit(){
+    rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    return static_cast<long>(limit.rlim_cur);
+}
+
+static void runClients(int connections, Shared *shared){
+    sockaddr_in server;
+    server.sin_family = AF_INET;
+    server.sin_port = htons(9025);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    while(!shared->listening.load(std::memory_order_acquire)){
+        ::usleep(1000);
+    }
+    std::vector<int> fds;
+    fds.reserve(connections);
+    HdrHistogram connectUs;
+    for(int i = 0; i < connections; ++i){
+        while(i - shared->accepted.load(std::memory_order_acquire) >= kMaxInFlight){
+            std::this_thread::yield();
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0){
+            perror("socket");
+            _exit(1);
+        }
+        // 只绑定源地址,端口推迟到connect时按四元组分配
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof(on));
+        sockaddr_in source;
+        source.sin_family = AF_INET;
+        source.sin_port = 0;
+        source.sin_addr.s_addr = htonl(0x7f000101 + i % kSourceAddrs);
+        Clock::time_point start = Clock::now();
+        if(::bind(fd, reinterpret_cast<sockaddr *>(&source), sizeof(source)) < 0
+           || ::connect(fd, reinterpret_cast<sockaddr *>(&server), sizeof(server)) < 0){
+            perror("connect");
+            _exit(1);
+        }
+        connectUs.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        fds.push_back(fd);
+    }
+    printf("client: %zu connects, connect() p50 %ld us, p99 %ld us, max %ld us\n", fds.size(),
+           static_cast<long>(connectUs.valueAtPercentile(50)), static_cast<long>(connectUs.valueAtPercentile(99)),
+           static_cast<long>(connectUs.max()));
+    fflush(stdout);
+    while(!shared->release.load(std::memory_order_acquire)){
+        ::usleep(10000);
+    }
+    for(int fd : fds){
+        ::close(fd);
+    }
+    _exit(0);
+}
+
+int main(int argc, char *argv[]){
+    int connections = argc > 1 ? atoi(argv[1]) : 19000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    int idleSeconds = argc > 3 ? atoi(argv[3]) : 5;
+
+    long fdLimit = raiseFdLimit();
+    if(connections > fdLimit - 64){
+        connections = static_cast<int>(fdLimit - 64);
+        printf("fd limit %ld, connections clamped to %d\n", fdLimit, connections);
+    }
+
+    // 在创建任何线程之前fork
+    Shared *shared = static_cast<Shared *>(::mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    new (shared) Shared{{0}, {0}, {false}, {false}};
+    Clock::time_point start = Clock::now();
+    pid_t child = ::fork();
+    if(child == 0){
+        runClients(connections, shared);
+    }
+
+    LoopLocal<long> perLoop;
+    EventLoop loop;
+    InetAddress addr(9025);
+    TcpServer server(&loop, addr, "scale");
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            ++perLoop.get();
+            shared->accepted.fetch_add(1, std::memory_order_release);
+        }
+        else{
+            --perLoop.get();
+            shared->closed.fetch_add(1, std::memory_order_release);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp){ buf->retrieveAll(); });
+    server.setThreadNum(threads);
+
+    long rssBefore = rssBytes();
+    server.start(); // 在loop线程中调用,返回时已经在监听
+    shared->listening.store(true, std::memory_order_release);
+
+    std::thread monitor([&](){
+        while(shared->accepted.load(std::memory_order_acquire) < connections){
+            int status;
+            if(::waitpid(child, &status, WNOHANG) == child){
+                printf("client exited early\n");
+                loop.quit();
+                return;
+            }
+            ::usleep(1000);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        long rss = rssBytes();
+        printf("server: %d connections established in %.3f s, %.0f accepts/s\n", connections, seconds,
+               connections / seconds);
+        printf("server: RSS %.1f MiB -> %.1f MiB, %.0f bytes per connection\n", rssBefore / 1048576.0,
+               rss / 1048576.0, static_cast<double>(rss - rssBefore) / connections);
+
+        std::vector<long> counts = invokeOnAll(server.getAllLoops(), [&](EventLoop *){ return perLoop.get(); }).get();
+        printf("server: connections per loop:");
+        for(long count : counts){
+            printf(" %ld", count);
+        }
+        printf(" (max/min %.3f)\n", static_cast<double>(*std::max_element(counts.begin(), counts.end()))
+                                    / std::max(1L, *std::min_element(counts.begin(), counts.end())));
+        fflush(stdout);
+
+        double cpuBefore = cpuSeconds();
+        Clock::time_point idleStart = Clock::now();
+        ::sleep(idleSeconds);
+        double cpu = cpuSeconds() - cpuBefore;
+        double wall = std::chrono::duration<double>(Clock::now() - idleStart).count();
+        printf("server: idle with %d connections: %.3f s CPU in %.1f s (%.2f%%)\n", connections, cpu, wall,
+               100.0 * cpu / wall);
+
+        Clock::time_point closeStart = Clock::now();
+        shared->release.store(true, std::memory_order_release);
+        while(shared->closed.load(std::memory_order_acquire) < connections){
+            ::usleep(1000);
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - closeStart).count();
+        printf("server: %d connections closed in %.3f s, %.0f closes/s\n", connections, seconds, connections / seconds);
+        ::waitpid(child, nullptr, 0);
+        loop.quit();
+    });
+
+    loop.loop();
+    monitor.join();
+    return 0;
+}
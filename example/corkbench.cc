@@ -0,0 +1,138 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/CurrentThread.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 每个请求的响应分三次send(头部、1KB正文、尾部),比较关闭/开启写合并时
+ * 服务端io线程每个请求的write系统调用次数与吞吐
+ * 写调用次数取自/proc/self/task/<tid>/io的syscw,其中也包括该线程输出日志的write
+ * 用法: ./corkbench [请求数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const char kRequest = 'r';
+static const std::string kHeader(64, 'h');
+static const std::string kBody(1024, 'b');
+static const std::string kTrailer(16, 't');
+static const size_t kResponseSize = kHeader.size() + kBody.size() + kTrailer.size();
+
+static bool writeAll(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::read(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static long writeSyscalls(pid_t tid){
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/io", tid);
+    FILE *fp = fopen(path, "r");
+    if(!fp){
+        return -1;
+    }
+    char line[128];
+    long value = -1;
+    while(fgets(line, sizeof(line), fp)){
+        if(sscanf(line, "syscw: %ld", &value) == 1){
+            break;
+        }
+    }
+    fclose(fp);
+    return value;
+}
+
+// 每批发送depth个请求,读完全部响应后再发下一批
+static void run(const char *name, const InetAddress &addr, pid_t serverTid, int requests, int depth){
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+        perror("connect");
+        return;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::string batch(depth, kRequest);
+    std::string reply(depth * kResponseSize, '\0');
+    long writesBefore = writeSyscalls(serverTid);
+    Clock::time_point start = Clock::now();
+    int rounds = requests / depth;
+    for(int i = 0; i < rounds; ++i){
+        if(!writeAll(fd, batch.data(), batch.size()) || !readAll(fd, &reply[0], reply.size())){
+            fprintf(stderr, "connection broken\n");
+            break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    long writes = writeSyscalls(serverTid) - writesBefore;
+    ::close(fd);
+    printf("%-8s depth %3d: %8.0f requests/s, %5.2f writes/request\n",
+           name, depth, rounds * depth / seconds, static_cast<double>(writes) / (rounds * depth));
+}
+
+int main(int argc, char *argv[]){
+    int requests = argc > 1 ? atoi(argv[1]) : 20000;
+
+    EventLoop loop;
+    InetAddress plainAddr(9012);
+    InetAddress corkedAddr(9013);
+
+    MessageCallback respond = [](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        while(buf->readableBytes() > 0){
+            buf->retrieve(1);
+            conn->send(kHeader);
+            conn->send(kBody);
+            conn->send(kTrailer);
+        }
+    };
+
+    std::atomic<pid_t> plainTid(0);
+    std::atomic<pid_t> corkedTid(0);
+    TcpServer plainServer(&loop, plainAddr, "plain");
+    TcpServer corkedServer(&loop, corkedAddr, "corked");
+    corkedServer.setCorking(true);
+    plainServer.setThreadInitCallback([&plainTid](EventLoop *){ plainTid = CurrentThread::tid(); });
+    corkedServer.setThreadInitCallback([&corkedTid](EventLoop *){ corkedTid = CurrentThread::tid(); });
+    for(TcpServer *server : {&plainServer, &corkedServer}){
+        server->setConnectionCallback([](const TcpConnectionPtr &conn){
+            if(conn->connected()) conn->setTcpNoDelay(true);
+        });
+        server->setMessageCallback(respond);
+        server->setThreadNum(1);
+        server->start();
+    }
+
+    std::thread client([&](){
+        for(int depth : {1, 16}){
+            run("plain", plainAddr, plainTid, requests, depth);
+            run("corked", corkedAddr, corkedTid, requests, depth);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
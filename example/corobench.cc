@@ -0,0 +1,134 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Coroutine.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 按行回显,比较回调写法与协程写法的开销
+ *   延迟: 64字节的行一问一答
+ *   吞吐: 每批1000行一次写出,全部回显后再发下一批
+ * 用法: ./corobench [往返次数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static bool writeAll(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::read(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 每批发送lines行,返回每批往返的平均耗时(微秒)
+static double pingPong(const InetAddress &addr, int lines, int rounds){
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+        perror("connect");
+        return -1;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::string line(63, 'x');
+    line += '\n';
+    std::string batch;
+    for(int i = 0; i < lines; ++i){
+        batch += line;
+    }
+    std::string reply(batch.size(), '\0');
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < rounds; ++i){
+        if(!writeAll(fd, batch.data(), batch.size()) || !readAll(fd, &reply[0], reply.size())){
+            fprintf(stderr, "connection broken\n");
+            break;
+        }
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+    ::close(fd);
+    return us;
+}
+
+static void callbackEcho(const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *eol;
+    while((eol = std::find(begin, end, '\n')) != end){
+        conn->send(std::string(begin, eol + 1));
+        begin = eol + 1;
+    }
+    buf->retrieve(begin - buf->peek());
+}
+
+static coro::Task coroutineEcho(coro::ConnectionPtr conn){
+    while(true){
+        std::string line = co_await conn->readUntil("\n");
+        if(line.empty()){
+            co_return;
+        }
+        co_await conn->write(line);
+    }
+}
+
+int main(int argc, char *argv[]){
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+
+    EventLoop loop;
+    InetAddress callbackAddr(9007);
+    InetAddress coroutineAddr(9008);
+
+    TcpServer callbackServer(&loop, callbackAddr, "callback-echo");
+    callbackServer.setMessageCallback(callbackEcho);
+    callbackServer.setConnectionCallback([](const TcpConnectionPtr &conn){
+        if(conn->connected()) conn->setTcpNoDelay(true);
+    });
+
+    TcpServer coroutineServer(&loop, coroutineAddr, "coroutine-echo");
+    coro::Connection::serve(coroutineServer, [](coro::ConnectionPtr conn){
+        conn->connection()->setTcpNoDelay(true);
+        return coroutineEcho(conn);
+    });
+
+    for(TcpServer *server : {&callbackServer, &coroutineServer}){
+        server->setThreadNum(1);
+        server->start();
+    }
+
+    std::thread client([&](){
+        const int kBatch = 1000;
+        struct { const char *name; const InetAddress *addr; } servers[] = {
+            {"callback", &callbackAddr}, {"coroutine", &coroutineAddr}
+        };
+        for(const auto &server : servers){
+            double latency = pingPong(*server.addr, 1, rounds);
+            double batch = pingPong(*server.addr, kBatch, rounds / 100 + 1);
+            printf("%-10s latency %7.2f us/round trip, throughput %8.0f lines/s\n",
+                   server.name, latency, kBatch / batch * 1e6);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
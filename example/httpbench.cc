@@ -0,0 +1,117 @@
+#include <mymuduo/HttpServer.h>
+#include <mymuduo/HttpRequest.h>
+#include <mymuduo/HttpResponse.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * wrk风格的本地压测: 进程内启动HttpServer,若干客户端连接以keep-alive方式不断发送小GET请求
+ * 用法: ./httpbench [连接数] [每连接流水线深度] [持续秒数] [服务端subloop数]
+ */
+
+static std::atomic<bool> g_stop(false);
+
+// 读取depth个响应,返回false表示连接出错
+static bool readResponses(int fd, std::string &pending, int depth){
+    char buf[16384];
+    while(depth > 0){
+        size_t headerEnd = pending.find("\r\n\r\n");
+        if(headerEnd != std::string::npos){
+            const char *cl = strstr(pending.c_str(), "Content-Length: ");
+            size_t bodyLen = cl ? strtoul(cl + 16, nullptr, 10) : 0;
+            size_t total = headerEnd + 4 + bodyLen;
+            if(pending.size() >= total){
+                pending.erase(0, total);
+                --depth;
+                continue;
+            }
+        }
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if(n <= 0){
+            return false;
+        }
+        pending.append(buf, n);
+    }
+    return true;
+}
+
+static void clientThread(const InetAddress &addr, int depth, std::atomic<long> *requests){
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+        perror("connect");
+        return;
+    }
+    std::string request;
+    for(int i = 0; i < depth; ++i){
+        request += "GET /hello HTTP/1.1\r\nHost: localhost\r\nUser-Agent: httpbench\r\n\r\n";
+    }
+    std::string pending;
+    long done = 0;
+    while(!g_stop){
+        if(::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())
+            || !readResponses(fd, pending, depth)){
+            fprintf(stderr, "connection broken\n");
+            break;
+        }
+        done += depth;
+    }
+    *requests += done;
+    ::close(fd);
+}
+
+int main(int argc, char *argv[]){
+    int connections = argc > 1 ? atoi(argv[1]) : 32;
+    int depth = argc > 2 ? atoi(argv[2]) : 1;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    int threads = argc > 4 ? atoi(argv[4]) : 4;
+
+    EventLoop loop;
+    InetAddress addr(9003);
+    HttpServer server(&loop, addr, "httpbench");
+    server.setHttpCallback([](const HttpRequest &req, HttpResponse *resp){
+        if(req.path() == "/hello"){
+            resp->setStatusCode(HttpResponse::k200Ok);
+            resp->setStatusMessage("OK");
+            resp->setContentType("text/plain");
+            resp->setBody("hello, world!\n");
+        }
+        else{
+            resp->setStatusCode(HttpResponse::k404NotFound);
+            resp->setStatusMessage("Not Found");
+        }
+    });
+    server.setThreadNum(threads);
+    server.start();
+
+    std::thread driver([&](){
+        std::atomic<long> requests(0);
+        std::vector<std::thread> clients;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < connections; ++i){
+            clients.emplace_back(clientThread, addr, depth, &requests);
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        g_stop = true;
+        for(std::thread &t : clients){
+            t.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%d connections, pipeline depth %d, %d server threads\n", connections, depth, threads);
+        printf("%ld requests in %.2f s, Requests/sec: %.0f\n", requests.load(), elapsed, requests / elapsed);
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
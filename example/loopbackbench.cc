@@ -0,0 +1,194 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/LoopbackTransport.h>
+#include <mymuduo/HdrHistogram.h>
+#include <mymuduo/logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 同一个回显回调分别跑在本机TCP连接和LoopbackTransport内存连接上,
+ * 两者的差就是内核协议栈的开销,剩下的是框架与回调本身的开销
+ *   乒乓: 若干连接各自一问一答发送小消息,统计请求速率与往返时间
+ *   流式: 一个连接持续发送大块数据并收回回显,统计吞吐
+ * 服务端与客户端各有一个io线程
+ * 用法: ./loopbackbench [每个连接的请求数] [流式的MiB数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const uint16_t kPort = 9027;
+static const int kConnections = 8;
+static const size_t kMessageSize = 64;
+static const size_t kChunkSize = 64 * 1024;
+static const int kChunksInFlight = 4;
+
+// 一轮测试的客户端, 回调都在客户端loop中执行
+class Round{
+public:
+    Round(EventLoop *loop, TcpServer *server, bool loopback, int connections)
+        : loop_(loop), server_(server), loopback_(loopback), connections_(connections), connected_(0)
+    {
+    }
+
+    ~Round(){
+        for(std::unique_ptr<TcpClient> &client : clients_){
+            client->disconnect();
+        }
+        // 等两端都处理完关闭再销毁TcpClient
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    // 全部连接建立后调用start(conn),在客户端loop中执行
+    void connect(const std::function<void(const TcpConnectionPtr &)> &start, const MessageCallback &onMessage,
+                 const WriteCompleteCallback &onWriteComplete = WriteCompleteCallback()){
+        for(int i = 0; i < connections_; ++i){
+            clients_.emplace_back(new TcpClient(loop_, InetAddress(kPort), "bench"));
+            TcpClient *client = clients_.back().get();
+            client->setConnectionCallback([this, start](const TcpConnectionPtr &conn){
+                if(!conn->connected()){
+                    return;
+                }
+                conn->setTcpNoDelay(true);
+                conns_.push_back(conn);
+                if(++connected_ == connections_){
+                    startTime_ = Clock::now();
+                    for(const TcpConnectionPtr &c : conns_){
+                        start(c);
+                    }
+                }
+            });
+            client->setMessageCallback(onMessage);
+            client->setWriteCompleteCallback(onWriteComplete);
+            if(loopback_){
+                TransportPtr serverSide, clientSide;
+                LoopbackTransport::createPair(&serverSide, &clientSide);
+                server_->acceptTransport(std::move(serverSide));
+                client->connect(std::move(clientSide));
+            }
+            else{
+                client->connect();
+            }
+        }
+    }
+
+    // 在客户端loop中调用,结束计时
+    void finish(){
+        done_.set_value(std::chrono::duration<double>(Clock::now() - startTime_).count());
+    }
+
+    double wait() { return done_.get_future().get(); }
+
+private:
+    EventLoop *loop_;
+    TcpServer *server_;
+    bool loopback_;
+    int connections_;
+    int connected_;
+    std::vector<std::unique_ptr<TcpClient>> clients_;
+    std::vector<TcpConnectionPtr> conns_;
+    Clock::time_point startTime_;
+    std::promise<double> done_;
+};
+
+static void runPingPong(EventLoop *loop, TcpServer *server, bool loopback, int requests){
+    const std::string message(kMessageSize, 'p');
+    HdrHistogram rtt;
+    int finished = 0;
+    std::vector<Clock::time_point> sentAt(kConnections);
+    std::vector<int> remaining(kConnections, requests);
+    Round round(loop, server, loopback, kConnections);
+    int nextIndex = 0;
+
+    round.connect([&](const TcpConnectionPtr &conn){
+        conn->setContext(std::make_shared<int>(nextIndex++));
+        sentAt[*std::static_pointer_cast<int>(conn->getContext())] = Clock::now();
+        conn->send(message);
+    }, [&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        while(buf->readableBytes() >= kMessageSize){
+            buf->retrieve(kMessageSize);
+            int index = *std::static_pointer_cast<int>(conn->getContext());
+            Clock::time_point now = Clock::now();
+            rtt.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - sentAt[index]).count());
+            if(--remaining[index] > 0){
+                sentAt[index] = now;
+                conn->send(message);
+            }
+            else if(++finished == kConnections){
+                round.finish();
+            }
+        }
+    });
+    double seconds = round.wait();
+    long total = static_cast<long>(requests) * kConnections;
+    printf("%-9s ping-pong: %8ld requests in %6.3f s: %8.0f req/s, rtt p50 %5.1f us, p99 %5.1f us, p99.9 %6.1f us\n",
+           loopback ? "loopback" : "tcp", total, seconds, total / seconds, rtt.valueAtPercentile(50) / 1000.0,
+           rtt.valueAtPercentile(99) / 1000.0, rtt.valueAtPercentile(99.9) / 1000.0);
+}
+
+static void runStream(EventLoop *loop, TcpServer *server, bool loopback, size_t totalBytes){
+    const std::string chunk(kChunkSize, 's');
+    size_t sent = 0;
+    size_t received = 0;
+    Round round(loop, server, loopback, 1);
+
+    auto sendMore = [&](const TcpConnectionPtr &conn){
+        for(int i = 0; i < kChunksInFlight && sent < totalBytes; ++i){
+            conn->send(chunk);
+            sent += kChunkSize;
+        }
+    };
+    round.connect(sendMore, [&](const TcpConnectionPtr &, Buffer *buf, Timestamp){
+        received += buf->readableBytes();
+        buf->retrieveAll();
+        if(received >= totalBytes){
+            round.finish();
+        }
+    }, sendMore);
+    double seconds = round.wait();
+    printf("%-9s stream:    %8.0f MiB in %6.3f s: %8.0f MiB/s\n", loopback ? "loopback" : "tcp",
+           totalBytes / 1048576.0, seconds, totalBytes / 1048576.0 / seconds);
+}
+
+int main(int argc, char *argv[]){
+    int requests = argc > 1 ? atoi(argv[1]) : 20000;
+    size_t streamBytes = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 1024) * 1024 * 1024;
+    ::signal(SIGPIPE, SIG_IGN);
+
+    // 被测的业务回调: 原样回显
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "loopback");
+    server.setConnectionCallback([](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            conn->setTcpNoDelay(true);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){ conn->send(buf); });
+    server.setThreadNum(1);
+    server.start();
+
+    std::thread driver([&](){
+        EventLoopThread clientThread;
+        EventLoop *clientLoop = clientThread.startLoop();
+        for(bool loopback : {false, true}){
+            runPingPong(clientLoop, &server, loopback, requests);
+        }
+        for(bool loopback : {false, true}){
+            runStream(clientLoop, &server, loopback, streamBytes);
+        }
+        loop.quit();
+    });
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/LoopMesh.h>
+#include "AllocCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 两个io线程之间转发消息,比较LoopMesh与逐条queueInLoop
+ *   吞吐: loop0每轮投递一批消息给loop1,统计每秒送达的消息数、每条消息的堆分配次数
+ *         以及LoopMesh平均每次唤醒排空的消息数
+ *   延迟: loop0与loop1之间一来一回地乒乓,统计往返时间的中位数与p99
+ * 用法: ./loopmeshbench [消息数] [乒乓次数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+// 分片服务之间转发的一个请求
+struct Message{
+    int64_t seq;
+    int64_t sentNs;
+    int64_t key;
+    int64_t value;
+};
+
+static const int kBurst = 256; // 发送方每轮最多投递的消息数
+
+static int64_t nowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// 等loop处理完此前投递的任务,之后才能修改它们引用的局部变量
+static void sync(EventLoop *loop){
+    std::promise<void> idle;
+    loop->queueInLoop([&idle](){ idle.set_value(); });
+    idle.get_future().wait();
+}
+
+static void report(const char *name, int64_t messages, double seconds, long allocs, double perWakeup){
+    printf("%-12s %9ld msgs in %6.3f s: %10.0f msgs/s, %5.2f allocs/msg", name, static_cast<long>(messages),
+           seconds, messages / seconds, static_cast<double>(allocs) / messages);
+    if(perWakeup > 0){
+        printf(", %6.1f msgs/wakeup", perWakeup);
+    }
+    printf("\n");
+}
+
+static void reportLatency(const char *name, std::vector<int64_t> &rtts){
+    std::sort(rtts.begin(), rtts.end());
+    printf("%-12s %9zu round trips: p50 %6.2f us, p99 %6.2f us\n", name, rtts.size(),
+           rtts[rtts.size() / 2] / 1000.0, rtts[rtts.size() * 99 / 100] / 1000.0);
+}
+
+int main(int argc, char *argv[]){
+    int64_t messages = argc > 1 ? atol(argv[1]) : 5000000;
+    int pings = argc > 2 ? atoi(argv[2]) : 50000;
+
+    // 排空任务引用mesh,mesh要比loop活得久
+    std::unique_ptr<LoopMesh<Message>> streamMesh;
+    std::unique_ptr<LoopMesh<Message>> pingMesh;
+    EventLoopThread thread0;
+    EventLoopThread thread1;
+    EventLoop *loop0 = thread0.startLoop();
+    EventLoop *loop1 = thread1.startLoop();
+    std::vector<EventLoop *> loops = {loop0, loop1};
+
+    // 吞吐: 只在loop1线程中计数
+    int64_t received = 0;
+    std::promise<void> streamDone;
+    auto onMessage = [&](const Message &){
+        if(++received == messages){
+            streamDone.set_value();
+        }
+    };
+    streamMesh.reset(new LoopMesh<Message>(loops, [&](size_t, Message &msg){ onMessage(msg); }));
+
+    for(int round = 0; round < 2; ++round){
+        bool useMesh = round == 1;
+        received = 0;
+        streamDone = std::promise<void>();
+        std::future<void> done = streamDone.get_future();
+        int64_t sent = 0;
+        std::function<void()> pump = [&](){
+            for(int i = 0; i < kBurst && sent < messages; ++i){
+                Message msg = {sent, 0, sent * 31, sent};
+                if(useMesh){
+                    if(!streamMesh->send(0, 1, msg)){
+                        break; // 环满了,让出loop0,下一轮再发
+                    }
+                }
+                else{
+                    loop1->queueInLoop([&onMessage, msg](){ onMessage(msg); });
+                }
+                ++sent;
+            }
+            if(sent < messages){
+                loop0->queueInLoop([&pump](){ pump(); });
+            }
+        };
+        long allocs = g_allocs.load();
+        int64_t drains = streamMesh->drains(1);
+        Clock::time_point start = Clock::now();
+        loop0->runInLoop([&pump](){ pump(); });
+        done.wait();
+        sync(loop0);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report(useMesh ? "LoopMesh" : "queueInLoop", messages, seconds, g_allocs.load() - allocs,
+               useMesh ? static_cast<double>(messages) / (streamMesh->drains(1) - drains) : 0);
+    }
+
+    // 延迟: loop0发出ping,loop1原样送回
+    std::vector<int64_t> rtts;
+    rtts.reserve(pings);
+    std::promise<void> pingDone;
+    std::function<void()> sendPing;
+    auto onPong = [&](const Message &msg){
+        rtts.push_back(nowNs() - msg.sentNs);
+        if(static_cast<int>(rtts.size()) == pings){
+            pingDone.set_value();
+        }
+        else{
+            sendPing();
+        }
+    };
+    pingMesh.reset(new LoopMesh<Message>(loops, [&](size_t from, Message &msg){
+        if(from == 0){
+            pingMesh->send(1, 0, msg);
+        }
+        else{
+            onPong(msg);
+        }
+    }));
+
+    for(int round = 0; round < 2; ++round){
+        bool useMesh = round == 1;
+        rtts.clear();
+        pingDone = std::promise<void>();
+        std::future<void> done = pingDone.get_future();
+        sendPing = [&, useMesh](){
+            Message msg = {static_cast<int64_t>(rtts.size()), nowNs(), 0, 0};
+            if(useMesh){
+                pingMesh->send(0, 1, msg);
+            }
+            else{
+                loop1->queueInLoop([&, msg](){
+                    loop0->queueInLoop([&, msg](){ onPong(msg); });
+                });
+            }
+        };
+        loop0->runInLoop([&sendPing](){ sendPing(); });
+        done.wait();
+        sync(loop0);
+        reportLatency(useMesh ? "LoopMesh" : "queueInLoop", rtts);
+    }
+    return 0;
+}
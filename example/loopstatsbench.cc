@@ -0,0 +1,129 @@
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/LoopLocal.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 按loop分片的统计与配置下发:
+ *   每个io线程模拟处理请求并更新统计(请求数、字节数),比较全局mutex保护的统计与LoopLocal
+ *   用invokeOnAll汇总所有loop的统计,核对总数并测量一次汇总的耗时
+ *   用invokeOnAll向所有loop下发新配置(LoopLocal中的配置快照)
+ * 用法: ./loopstatsbench [io线程数] [每个线程的请求数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+struct Stats{
+    int64_t requests = 0;
+    int64_t bytes = 0;
+};
+
+struct Config{
+    int version = 0;
+    std::string backend = "default";
+};
+
+static std::mutex g_mutex;
+static Stats g_stats; // 对照组: 所有线程共享,受g_mutex保护
+
+static LoopLocal<Stats> t_stats;
+static LoopLocal<Config> t_config;
+
+static const int kBurst = 1024; // 每轮模拟处理的请求数,之后让出loop
+
+// 在每个loop上处理requests个请求,全部完成后返回
+static double run(const std::vector<EventLoop *> &loops, int64_t requests, bool useLocal){
+    Clock::time_point start = Clock::now();
+    std::vector<std::promise<void>> done(loops.size());
+    std::vector<std::function<void()>> pumps(loops.size());
+    for(size_t i = 0; i < loops.size(); ++i){
+        std::shared_ptr<int64_t> handled = std::make_shared<int64_t>(0);
+        EventLoop *loop = loops[i];
+        std::function<void()> *pump = &pumps[i];
+        std::promise<void> *finished = &done[i];
+        pumps[i] = [=](){
+            for(int n = 0; n < kBurst && *handled < requests; ++n, ++*handled){
+                int64_t bytes = 64 + (*handled & 511);
+                if(useLocal){
+                    Stats &stats = t_stats.get();
+                    ++stats.requests;
+                    stats.bytes += bytes;
+                }
+                else{
+                    std::unique_lock<std::mutex> lock(g_mutex);
+                    ++g_stats.requests;
+                    g_stats.bytes += bytes;
+                }
+            }
+            if(*handled < requests){
+                loop->queueInLoop([pump](){ (*pump)(); });
+            }
+            else{
+                finished->set_value();
+            }
+        };
+        loop->runInLoop([pump](){ (*pump)(); });
+    }
+    for(auto &promise : done){
+        promise.get_future().wait();
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]){
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int64_t requests = argc > 2 ? atol(argv[2]) : 5000000;
+    const int gathers = 10000;
+
+    std::vector<std::unique_ptr<EventLoopThread>> loopThreads;
+    std::vector<EventLoop *> loops;
+    for(int i = 0; i < threads; ++i){
+        loopThreads.emplace_back(new EventLoopThread);
+        loops.push_back(loopThreads.back()->startLoop());
+    }
+    const double total = static_cast<double>(requests) * threads;
+
+    double seconds = run(loops, requests, false);
+    printf("global mutex %d x %ld requests in %6.3f s: %10.0f updates/s\n", threads,
+           static_cast<long>(requests), seconds, total / seconds);
+
+    seconds = run(loops, requests, true);
+    printf("LoopLocal    %d x %ld requests in %6.3f s: %10.0f updates/s\n", threads,
+           static_cast<long>(requests), seconds, total / seconds);
+
+    // 汇总: 每个loop返回自己的统计,调用线程合并
+    std::vector<Stats> perLoop = invokeOnAll(loops, [](EventLoop *){ return t_stats.get(); }).get();
+    int64_t sum = 0;
+    for(const Stats &stats : perLoop){
+        sum += stats.requests;
+    }
+    printf("gathered %ld requests from %zu loops (%s), global counter %ld\n", static_cast<long>(sum),
+           perLoop.size(), sum == requests * threads ? "ok" : "MISMATCH", static_cast<long>(g_stats.requests));
+
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < gathers; ++i){
+        invokeOnAll(loops, [](EventLoop *){ return t_stats.get().requests; }).get();
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("invokeOnAll  %d gathers over %d loops: %6.2f us per gather\n", gathers, threads, seconds * 1e6 / gathers);
+
+    // 下发配置: 每个loop替换自己的快照,之后该loop上的请求无锁读取
+    invokeOnAll(loops, [](EventLoop *){
+        Config &config = t_config.get();
+        ++config.version;
+        config.backend = "10.0.0.2:9000";
+    }).get();
+    std::vector<int> versions = invokeOnAll(loops, [](EventLoop *){ return t_config.get().version; }).get();
+    printf("config version on each loop after reload: %d..%d\n", versions.front(), versions.back());
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/TrafficRecorder.h>
+#include <mymuduo/HdrHistogram.h>
+#include <mymuduo/logger.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * 回放TrafficRecorder录制的流量: 为每个录制下来的连接重新建立一个到目标服务端的连接,
+ * 把当时收到的数据作为请求发出,按录制下来的响应长度判断响应是否收齐
+ *   原始节奏: 连接与每个请求按录制时的相对时间发出(可用倍速缩放)
+ *   全速: 所有连接同时建立,每个请求在上一个请求的响应收齐后立即发出
+ * 报告请求数、收发字节、吞吐以及请求到响应收齐的延迟分布
+ * 用法: ./replay <录制文件> [ip] [port] [max|倍速] [超时秒数]
+ */
+
+// 一次交互: 一段连续收到的数据,以及其后服务端发送的字节数
+struct Exchange{
+    int64_t offsetUs; // 相对于录制开始
+    std::string request;
+    size_t responseBytes;
+};
+
+struct Session{
+    int64_t openUs;
+    std::vector<Exchange> exchanges;
+    size_t next = 0;
+    size_t received = 0;
+    size_t expected = 0; // 已发出请求对应的响应总字节数
+    std::deque<std::pair<Timestamp, size_t>> outstanding; // (发出时间, 收齐时的received)
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr conn;
+    bool finished = false;
+};
+
+// 按连接整理记录; 没有对应建立记录的连接(录制开始前已建立)被忽略
+static std::vector<std::unique_ptr<Session>> buildSessions(const std::vector<TrafficRecorder::Record> &records,
+                                                          int64_t *baseUs){
+    std::map<int64_t, Session *> byId;
+    std::vector<std::unique_ptr<Session>> sessions;
+    *baseUs = records.empty() ? 0 : records.front().timeUs;
+    for(const TrafficRecorder::Record &record : records){
+        *baseUs = std::min(*baseUs, record.timeUs);
+    }
+    for(const TrafficRecorder::Record &record : records){
+        if(record.type == TrafficRecorder::kOpen){
+            sessions.emplace_back(new Session);
+            sessions.back()->openUs = record.timeUs - *baseUs;
+            byId[record.connId] = sessions.back().get();
+            continue;
+        }
+        auto it = byId.find(record.connId);
+        if(it == byId.end()){
+            continue;
+        }
+        std::vector<Exchange> &exchanges = it->second->exchanges;
+        switch(record.type){
+        case TrafficRecorder::kInbound:
+            if(exchanges.empty() || exchanges.back().responseBytes > 0){
+                exchanges.push_back(Exchange{record.timeUs - *baseUs, std::string(), 0});
+            }
+            exchanges.back().request += record.data;
+            break;
+        case TrafficRecorder::kOutbound:
+        case TrafficRecorder::kOutboundLength:
+            if(exchanges.empty()){ // 服务端先发送的数据(如欢迎信息)
+                exchanges.push_back(Exchange{it->second->openUs, std::string(), 0});
+            }
+            exchanges.back().responseBytes += record.length;
+            break;
+        default:
+            byId.erase(it);
+            break;
+        }
+    }
+    return sessions;
+}
+
+class Replayer{
+public:
+    Replayer(EventLoop *loop, const InetAddress &addr, std::vector<std::unique_ptr<Session>> sessions,
+             bool maxSpeed, double speed)
+        : loop_(loop), addr_(addr), sessions_(std::move(sessions)), maxSpeed_(maxSpeed), speed_(speed)
+        , finished_(0), requests_(0), requestBytes_(0), responseBytes_(0)
+    {
+    }
+
+    void start(){
+        start_ = Timestamp::now();
+        for(std::unique_ptr<Session> &session : sessions_){
+            Session *s = session.get();
+            s->client.reset(new TcpClient(loop_, addr_, "replay"));
+            s->client->setConnectionCallback([this, s](const TcpConnectionPtr &conn){ onConnection(s, conn); });
+            s->client->setMessageCallback([this, s](const TcpConnectionPtr &, Buffer *buf, Timestamp now){
+                onMessage(s, buf, now);
+            });
+            if(maxSpeed_){
+                s->client->connect();
+            }
+            else{
+                loop_->runAfter(scaled(s->openUs), [s](){ s->client->connect(); });
+            }
+        }
+        if(sessions_.empty()){
+            loop_->quit();
+        }
+    }
+
+    void report(bool timedOut){
+        double seconds = timeDifference(Timestamp::now(), start_);
+        printf("replayed %zu/%zu connections, %ld requests in %.3f s%s\n", finished_, sessions_.size(),
+               static_cast<long>(requests_), seconds, timedOut ? " (timed out)" : "");
+        printf("  %.0f req/s, sent %.1f MiB, received %.1f MiB (%.1f MiB/s)\n", requests_ / seconds,
+               requestBytes_ / 1048576.0, responseBytes_ / 1048576.0, responseBytes_ / 1048576.0 / seconds);
+        printf("  latency: mean %.1f us, p50 %ld us, p99 %ld us, p99.9 %ld us, max %ld us\n", latency_.mean(),
+               static_cast<long>(latency_.valueAtPercentile(50)), static_cast<long>(latency_.valueAtPercentile(99)),
+               static_cast<long>(latency_.valueAtPercentile(99.9)), static_cast<long>(latency_.max()));
+    }
+
+    void stopAll(){
+        for(std::unique_ptr<Session> &session : sessions_){
+            session->client->stop();
+            session->client->disconnect();
+        }
+    }
+
+private:
+    double scaled(int64_t offsetUs) const { return offsetUs / 1e6 / speed_; }
+
+    void onConnection(Session *s, const TcpConnectionPtr &conn){
+        if(!conn->connected()){
+            finish(s);
+            return;
+        }
+        conn->setTcpNoDelay(true);
+        s->conn = conn;
+        if(maxSpeed_){
+            sendNext(s);
+            return;
+        }
+        double elapsed = timeDifference(Timestamp::now(), start_);
+        for(size_t i = 0; i < s->exchanges.size(); ++i){
+            double delay = std::max(0.0, scaled(s->exchanges[i].offsetUs) - elapsed);
+            loop_->runAfter(delay, [this, s](){ sendNext(s); });
+        }
+        checkDone(s);
+    }
+
+    // 发出下一个请求; 全速模式下不等待响应的请求(录制时没有响应)连续发出
+    void sendNext(Session *s){
+        while(s->next < s->exchanges.size() && s->conn && s->conn->connected()){
+            const Exchange &exchange = s->exchanges[s->next++];
+            s->expected += exchange.responseBytes;
+            if(!exchange.request.empty()){
+                s->conn->send(exchange.request);
+                ++requests_;
+                requestBytes_ += exchange.request.size();
+            }
+            if(exchange.responseBytes > 0){
+                s->outstanding.emplace_back(Timestamp::now(), s->expected);
+            }
+            if(!maxSpeed_ || exchange.responseBytes > 0){
+                break;
+            }
+        }
+        checkDone(s);
+    }
+
+    void onMessage(Session *s, Buffer *buf, Timestamp now){
+        s->received += buf->readableBytes();
+        responseBytes_ += buf->readableBytes();
+        buf->retrieveAll();
+        while(!s->outstanding.empty() && s->received >= s->outstanding.front().second){
+            latency_.record(microSecondsDifference(now, s->outstanding.front().first));
+            s->outstanding.pop_front();
+        }
+        if(maxSpeed_ && s->outstanding.empty()){
+            sendNext(s);
+        }
+        else{
+            checkDone(s);
+        }
+    }
+
+    // 所有请求已发出且响应收齐后关闭连接
+    void checkDone(Session *s){
+        if(s->next == s->exchanges.size() && s->outstanding.empty() && s->conn && s->conn->connected()){
+            s->conn->shutdown();
+        }
+    }
+
+    void finish(Session *s){
+        if(s->finished){
+            return;
+        }
+        s->finished = true;
+        s->conn.reset();
+        if(++finished_ == sessions_.size()){
+            loop_->quit();
+        }
+    }
+
+    EventLoop *loop_;
+    InetAddress addr_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    bool maxSpeed_;
+    double speed_;
+    Timestamp start_;
+    size_t finished_;
+    int64_t requests_;
+    int64_t requestBytes_;
+    int64_t responseBytes_;
+    HdrHistogram latency_;
+};
+
+int main(int argc, char *argv[]){
+    if(argc < 2){
+        fprintf(stderr, "usage: %s <capture> [ip] [port] [max|speed] [timeout]\n", argv[0]);
+        return 1;
+    }
+    std::string ip = argc > 2 ? argv[2] : "127.0.0.1";
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9026);
+    bool maxSpeed = argc > 4 && strcmp(argv[4], "max") == 0;
+    double speed = argc > 4 && !maxSpeed ? atof(argv[4]) : 1.0;
+    double timeout = argc > 5 ? atof(argv[5]) : 60;
+    ::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<TrafficRecorder::Record> records;
+    if(!TrafficRecorder::load(argv[1], &records)){
+        fprintf(stderr, "cannot read capture %s\n", argv[1]);
+        return 1;
+    }
+    int64_t baseUs = 0;
+    std::vector<std::unique_ptr<Session>> sessions = buildSessions(records, &baseUs);
+    size_t exchanges = 0;
+    for(const std::unique_ptr<Session> &session : sessions){
+        exchanges += session->exchanges.size();
+    }
+    printf("%zu records, %zu connections, %zu exchanges, mode %s\n", records.size(), sessions.size(), exchanges,
+           maxSpeed ? "max speed" : "original timing");
+
+    EventLoop loop;
+    Replayer replayer(&loop, InetAddress(port, ip), std::move(sessions), maxSpeed, speed > 0 ? speed : 1.0);
+    bool timedOut = false;
+    loop.runAfter(timeout, [&](){
+        timedOut = true;
+        loop.quit();
+    });
+    replayer.start();
+    loop.loop();
+    replayer.report(timedOut);
+    replayer.stopAll();
+    return 0;
+}
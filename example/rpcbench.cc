@@ -0,0 +1,112 @@
+#include <mymuduo/RpcServer.h>
+#include <mymuduo/RpcClient.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * RPC环回压测: 单个连接上保持concurrency个未完成的调用,随并发度增加测量 calls/s 与延迟
+ * 服务端的echo方法把结果交给另一个线程返回,模拟异步处理
+ * 用法: ./rpcbench [每个并发度下的调用次数] [请求大小(字节)]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+struct Round{
+    RpcClient *client;
+    std::string payload;
+    int total;
+    int issued = 0;
+    int done = 0;
+    std::vector<double> latencies; // 微秒
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // 在client的loop线程中执行
+    void issue(){
+        ++issued;
+        Clock::time_point start = Clock::now();
+        client->call("echo", payload, [this, start](rpc::Status status, const std::string &){
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            if(status != rpc::kOk){
+                fprintf(stderr, "call failed: %d\n", status);
+            }
+            if(issued < total){
+                issue();
+            }
+            if(++done == total){
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.notify_one();
+            }
+        });
+    }
+};
+
+int main(int argc, char *argv[]){
+    int calls = argc > 1 ? atoi(argv[1]) : 100000;
+    size_t size = argc > 2 ? atoi(argv[2]) : 64;
+
+    EventLoopThread serverThread;
+    EventLoop *serverLoop = serverThread.startLoop();
+    EventLoopThread replyThread; // 处理函数在这里异步返回结果
+    EventLoop *replyLoop = replyThread.startLoop();
+
+    InetAddress addr(9004);
+    RpcServer server(serverLoop, addr, "rpcbench");
+    server.registerMethod("echo", [replyLoop](const std::string &request, const RpcServer::RpcDone &done){
+        replyLoop->queueInLoop([request, done](){ done(request); });
+    });
+    serverLoop->runInLoop([&server](){ server.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EventLoopThread clientThread;
+    EventLoop *clientLoop = clientThread.startLoop();
+    RpcClient client(clientLoop, addr, "rpcbench-client");
+    client.connect();
+    while(!client.connected()){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    int levels[] = {1, 4, 16, 64, 256};
+    for(int concurrency : levels){
+        Round round;
+        round.client = &client;
+        round.payload.assign(size, 'x');
+        round.total = calls;
+        round.latencies.reserve(calls);
+
+        Clock::time_point start = Clock::now();
+        clientLoop->runInLoop([&round, concurrency](){
+            for(int i = 0; i < concurrency && round.issued < round.total; ++i){
+                round.issue();
+            }
+        });
+        {
+            std::unique_lock<std::mutex> lock(round.mutex);
+            round.cond.wait(lock, [&round](){ return round.done == round.total; });
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::sort(round.latencies.begin(), round.latencies.end());
+        double sum = 0;
+        for(double l : round.latencies){
+            sum += l;
+        }
+        printf("concurrency %4d: %8.0f calls/s  avg %8.1f us  p50 %8.1f us  p99 %8.1f us\n",
+               concurrency, calls / seconds, sum / calls,
+               round.latencies[calls / 2], round.latencies[calls * 99 / 100]);
+    }
+    // 先在client的loop中断开连接,RpcClient析构后不能再有响应到达
+    client.disconnect();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return 0;
+}
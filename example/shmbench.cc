@@ -0,0 +1,216 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/ShmTransport.h>
+#include <mymuduo/ShmListener.h>
+#include <mymuduo/HdrHistogram.h>
+#include <mymuduo/logger.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * 同机进程间通信: 客户端进程分别经本机TCP、Unix域socket与ShmTransport共享内存连接服务端进程,
+ * 服务端三种连接用同一个回显回调
+ *   乒乓: 一个连接一问一答发送64字节消息,统计往返时间与请求速率
+ *   流式: 一个连接持续发送64KB数据块并收回回显,统计吞吐
+ * 用法: ./shmbench [乒乓次数] [流式的MiB数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const uint16_t kPort = 9028;
+static const size_t kMessageSize = 64;
+static const size_t kChunkSize = 64 * 1024;
+static const int kChunksInFlight = 4;
+
+enum Kind{ kTcp, kUnix, kShm };
+static const char *kKindNames[] = {"tcp", "unix", "shm"};
+
+static InetAddress unixAddr() { return InetAddress::unixAddress("mymuduo-shmbench-unix", true); }
+static InetAddress shmAddr() { return InetAddress::unixAddress("mymuduo-shmbench-shm", true); }
+
+// 客户端进程中的一个连接, 回调都在客户端loop中执行
+class Session{
+public:
+    Session(EventLoop *loop, Kind kind) : kind_(kind)
+    {
+        client_.reset(new TcpClient(loop, kind == kTcp ? InetAddress(kPort) : unixAddr(), kKindNames[kind]));
+    }
+
+    ~Session(){
+        client_->disconnect();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    // 连接建立后在客户端loop中调用start(conn), 返回false表示连接失败
+    bool connect(const std::function<void(const TcpConnectionPtr &)> &start, const MessageCallback &onMessage,
+                 const WriteCompleteCallback &onWriteComplete = WriteCompleteCallback()){
+        client_->setConnectionCallback([this, start](const TcpConnectionPtr &conn){
+            if(conn->connected()){
+                if(kind_ == kTcp){
+                    conn->setTcpNoDelay(true);
+                }
+                startTime_ = Clock::now();
+                start(conn);
+            }
+        });
+        client_->setMessageCallback(onMessage);
+        client_->setWriteCompleteCallback(onWriteComplete);
+        if(kind_ == kShm){
+            TransportPtr transport = ShmTransport::connect(shmAddr());
+            if(!transport){
+                return false;
+            }
+            client_->connect(std::move(transport));
+        }
+        else{
+            client_->connect();
+        }
+        return true;
+    }
+
+    void finish() { done_.set_value(std::chrono::duration<double>(Clock::now() - startTime_).count()); }
+    double wait() { return done_.get_future().get(); }
+
+private:
+    Kind kind_;
+    std::unique_ptr<TcpClient> client_;
+    Clock::time_point startTime_;
+    std::promise<double> done_;
+};
+
+static void runPingPong(EventLoop *loop, Kind kind, int requests){
+    const std::string message(kMessageSize, 'p');
+    HdrHistogram rtt;
+    Clock::time_point sentAt;
+    int remaining = requests;
+    Session session(loop, kind);
+    bool ok = session.connect([&](const TcpConnectionPtr &conn){
+        sentAt = Clock::now();
+        conn->send(message);
+    }, [&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        while(buf->readableBytes() >= kMessageSize){
+            buf->retrieve(kMessageSize);
+            Clock::time_point now = Clock::now();
+            rtt.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - sentAt).count());
+            if(--remaining > 0){
+                sentAt = now;
+                conn->send(message);
+            }
+            else{
+                session.finish();
+            }
+        }
+    });
+    if(!ok){
+        printf("%-5s connect failed\n", kKindNames[kind]);
+        return;
+    }
+    double seconds = session.wait();
+    printf("%-5s ping-pong: %7d round trips in %6.3f s: %7.0f req/s, rtt p50 %5.1f us, p99 %5.1f us, p99.9 %6.1f us\n",
+           kKindNames[kind], requests, seconds, requests / seconds, rtt.valueAtPercentile(50) / 1000.0,
+           rtt.valueAtPercentile(99) / 1000.0, rtt.valueAtPercentile(99.9) / 1000.0);
+}
+
+static void runStream(EventLoop *loop, Kind kind, size_t totalBytes){
+    const std::string chunk(kChunkSize, 's');
+    size_t sent = 0;
+    size_t received = 0;
+    Session session(loop, kind);
+    auto sendMore = [&](const TcpConnectionPtr &conn){
+        for(int i = 0; i < kChunksInFlight && sent < totalBytes; ++i){
+            conn->send(chunk);
+            sent += kChunkSize;
+        }
+    };
+    bool ok = session.connect(sendMore, [&](const TcpConnectionPtr &, Buffer *buf, Timestamp){
+        received += buf->readableBytes();
+        buf->retrieveAll();
+        if(received >= totalBytes){
+            session.finish();
+        }
+    }, sendMore);
+    if(!ok){
+        printf("%-5s connect failed\n", kKindNames[kind]);
+        return;
+    }
+    double seconds = session.wait();
+    printf("%-5s stream:    %7.0f MiB in %6.3f s: %7.0f MiB/s\n", kKindNames[kind], totalBytes / 1048576.0,
+           seconds, totalBytes / 1048576.0 / seconds);
+}
+
+static void runClient(int readyFd, int requests, size_t streamBytes){
+    char ready;
+    if(::read(readyFd, &ready, 1) != 1){
+        _exit(1);
+    }
+    EventLoopThread clientThread;
+    EventLoop *loop = clientThread.startLoop();
+    for(Kind kind : {kTcp, kUnix, kShm}){
+        runPingPong(loop, kind, requests);
+    }
+    for(Kind kind : {kTcp, kUnix, kShm}){
+        runStream(loop, kind, streamBytes);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]){
+    int requests = argc > 1 ? atoi(argv[1]) : 50000;
+    size_t streamBytes = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 1024) * 1024 * 1024;
+    ::signal(SIGPIPE, SIG_IGN);
+
+    // 在创建任何线程之前fork, 服务端开始监听后通过管道通知客户端
+    int readyPipe[2];
+    if(::pipe(readyPipe) < 0){
+        perror("pipe");
+        return 1;
+    }
+    pid_t child = ::fork();
+    if(child == 0){
+        ::close(readyPipe[1]);
+        runClient(readyPipe[0], requests, streamBytes);
+        return 0;
+    }
+    ::close(readyPipe[0]);
+
+    auto echo = [](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){ conn->send(buf); };
+    auto onConnection = [](const TcpConnectionPtr &conn){
+        if(conn->connected() && conn->peerAddress().family() == AF_INET){
+            conn->setTcpNoDelay(true);
+        }
+    };
+    EventLoop loop;
+    TcpServer tcpServer(&loop, InetAddress(kPort), "tcp");
+    TcpServer unixServer(&loop, unixAddr(), "unix");
+    for(TcpServer *server : {&tcpServer, &unixServer}){
+        server->setConnectionCallback(onConnection);
+        server->setMessageCallback(echo);
+        server->setThreadNum(1);
+        server->start();
+    }
+    // 共享内存连接也交给tcpServer, 与TCP连接共用一个subloop和同一个回调
+    ShmListener shmListener(&loop, shmAddr(), &tcpServer);
+    shmListener.listen();
+
+    char ready = 'r';
+    if(::write(readyPipe[1], &ready, 1) != 1){
+        perror("write");
+    }
+    std::thread reaper([&](){
+        ::waitpid(child, nullptr, 0);
+        loop.quit();
+    });
+    loop.loop();
+    reaper.join();
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/TlsContext.h>
+#include <mymuduo/TlsSession.h>
+#include <mymuduo/logger.h>
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 回环地址上的TLS基准:
+ *   握手速率: 若干TcpClient反复建立TLS连接,握手完成后立即关闭,比较完整握手与会话恢复(ticket)
+ *   批量吞吐: 服务端向一个连接发送大量数据,比较明文TCP与TLS
+ * 证书为启动时生成的自签名P-256证书,客户端不校验
+ * 用法: ./tlsbench [握手次数] [批量数据MB]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t kChunkSize = 64 * 1024;
+
+// 生成自签名证书并加载到服务端的SSL_CTX
+static bool useSelfSignedCertificate(TlsContext *context){
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    if(pkey == nullptr || x509 == nullptr){
+        return false;
+    }
+    X509_set_version(x509, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 24 * 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    bool ok = X509_sign(x509, pkey, EVP_sha256()) > 0
+        && SSL_CTX_use_certificate(context->nativeHandle(), x509) == 1
+        && SSL_CTX_use_PrivateKey(context->nativeHandle(), pkey) == 1;
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    return ok;
+}
+
+// clients个TcpClient并发地反复握手,总共完成handshakes次后返回
+static void runHandshakes(const char *name, EventLoop *loop, const InetAddress &addr,
+                          const TlsContextPtr &context, int handshakes, int clients){
+    int done = 0;
+    int reused = 0;
+    int live = 0;
+    std::vector<std::unique_ptr<TcpClient>> tcpClients;
+    for(int i = 0; i < clients; ++i){
+        tcpClients.emplace_back(new TcpClient(loop, addr, name));
+    }
+    auto stopAll = [&tcpClients](){
+        for(auto &client : tcpClients){
+            client->stop();
+            client->disconnect();
+        }
+    };
+    Clock::time_point start = Clock::now();
+    for(auto &client : tcpClients){
+        client->setTlsContext(context);
+        client->enableRetry(); // 连接关闭后立即重连
+        client->setConnectionCallback([&, loop](const TcpConnectionPtr &conn){
+            if(conn->connected()){
+                ++live;
+                ++done;
+                reused += conn->tlsSession()->sessionReused() ? 1 : 0;
+                if(done >= handshakes){
+                    stopAll();
+                }
+                else{
+                    conn->shutdown();
+                }
+            }
+            else{
+                --live;
+                if(done >= handshakes && live == 0){
+                    loop->quit();
+                }
+            }
+        });
+        client->connect();
+    }
+    loop->loop();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-10s %6d handshakes in %6.3f s: %8.0f handshakes/s, %5.1f%% resumed\n",
+           name, done, seconds, done / seconds, 100.0 * reused / done);
+}
+
+// 从服务端接收它发来的全部数据
+static void runBulk(const char *name, EventLoop *loop, const InetAddress &addr,
+                    const TlsContextPtr &context, size_t total){
+    TcpClient client(loop, addr, name);
+    if(context){
+        client.setTlsContext(context);
+    }
+    size_t received = 0;
+    Clock::time_point start;
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            start = Clock::now();
+        }
+        else{
+            loop->quit();
+        }
+    });
+    client.setMessageCallback([&](const TcpConnectionPtr &, Buffer *buf, Timestamp){
+        received += buf->readableBytes();
+        buf->retrieveAll();
+    });
+    client.connect();
+    loop->loop();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-10s %6zu MiB in %6.3f s: %8.1f MiB/s%s\n", name, received >> 20, seconds,
+           (received >> 20) / seconds, received == total ? "" : " (incomplete)");
+}
+
+// 连接建立后发送total字节,发完后关闭
+static void serveBulk(TcpServer *server, size_t total){
+    static const std::string chunk(kChunkSize, 'x');
+    auto sendMore = [total](const TcpConnectionPtr &conn){
+        size_t *sent = static_cast<size_t *>(conn->getContext().get());
+        if(*sent >= total){
+            conn->shutdown();
+            return;
+        }
+        conn->send(chunk);
+        *sent += chunk.size();
+    };
+    server->setConnectionCallback([sendMore](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            conn->setContext(std::make_shared<size_t>(0));
+            sendMore(conn);
+        }
+    });
+    server->setWriteCompleteCallback(sendMore);
+}
+
+int main(int argc, char *argv[]){
+    int handshakes = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t total = (argc > 2 ? atol(argv[2]) : 512) << 20;
+    // 对端关闭后服务端仍可能在发送ticket
+    ::signal(SIGPIPE, SIG_IGN);
+
+    TlsContextPtr serverContext = std::make_shared<TlsContext>(TlsContext::kServer);
+    if(!useSelfSignedCertificate(serverContext.get())){
+        fprintf(stderr, "failed to create certificate\n");
+        return 1;
+    }
+
+    EventLoop loop;
+    InetAddress handshakeAddr(9020);
+    InetAddress plainBulkAddr(9021);
+    InetAddress tlsBulkAddr(9022);
+
+    TcpServer handshakeServer(&loop, handshakeAddr, "handshake");
+    handshakeServer.setTlsContext(serverContext);
+    MessageCallback discard = [](const TcpConnectionPtr &, Buffer *buf, Timestamp){ buf->retrieveAll(); };
+    handshakeServer.setConnectionCallback([](const TcpConnectionPtr &){});
+    handshakeServer.setMessageCallback(discard);
+
+    TcpServer plainBulkServer(&loop, plainBulkAddr, "plainbulk");
+    TcpServer tlsBulkServer(&loop, tlsBulkAddr, "tlsbulk");
+    tlsBulkServer.setTlsContext(serverContext);
+    serveBulk(&plainBulkServer, total);
+    serveBulk(&tlsBulkServer, total);
+    plainBulkServer.setMessageCallback(discard);
+    tlsBulkServer.setMessageCallback(discard);
+
+    for(TcpServer *server : {&handshakeServer, &plainBulkServer, &tlsBulkServer}){
+        server->setThreadNum(1);
+        server->start();
+    }
+
+    std::thread client([&](){
+        EventLoop clientLoop;
+        // 服务端用的是自签名证书,客户端不校验
+        auto newClientContext = [](){
+            TlsContextPtr context = std::make_shared<TlsContext>(TlsContext::kClient);
+            context->setVerifyNone();
+            return context;
+        };
+        // 关闭会话恢复的客户端每次都做完整握手
+        TlsContextPtr fullContext = newClientContext();
+        fullContext->setSessionResumption(false);
+        TlsContextPtr resumeContext = newClientContext();
+
+        runHandshakes("full", &clientLoop, handshakeAddr, fullContext, handshakes, 4);
+        runHandshakes("resumed", &clientLoop, handshakeAddr, resumeContext, handshakes, 4);
+        runBulk("plain", &clientLoop, plainBulkAddr, nullptr, total);
+        runBulk("tls", &clientLoop, tlsBulkAddr, newClientContext(), total);
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Tracer.h>
+#include <mymuduo/logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 请求追踪的开销与输出: 若干客户端线程一问一答(64B请求,4KB响应),
+ * 分别在关闭采样、每100个采样1个、全部采样时测量吞吐,并打印各阶段延迟的百分位
+ * 最后一轮的span导出为Chrome trace-event JSON
+ * 用法: ./tracebench [每轮每个客户端的请求数] [trace文件]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t kRequestSize = 64;
+static const std::string kResponse(4096, 'r');
+
+static bool writeAll(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::read(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void runClient(int requests, std::atomic<long> *done){
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(9024);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0){
+        perror("connect");
+        return;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::string request(kRequestSize, 'q');
+    std::string response(kResponse.size(), '\0');
+    for(int i = 0; i < requests; ++i){
+        if(!writeAll(fd, request.data(), request.size()) || !readAll(fd, &response[0], response.size())){
+            break;
+        }
+        done->fetch_add(1, std::memory_order_relaxed);
+    }
+    ::close(fd);
+}
+
+static void runRound(const char *name, int sampling, int clients, int requests){
+    Tracer::reset();
+    Tracer::setSampling(sampling);
+    std::atomic<long> done(0);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for(int i = 0; i < clients; ++i){
+        threads.emplace_back(runClient, requests, &done);
+    }
+    for(std::thread &thread : threads){
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-14s %8ld requests in %6.3f s: %8.0f req/s\n", name, done.load(), seconds, done.load() / seconds);
+    if(sampling == 0){
+        return;
+    }
+    for(int stage = 0; stage < Tracer::kNumStages; ++stage){
+        HdrHistogram histogram = Tracer::histogram(static_cast<Tracer::Stage>(stage));
+        printf("    %-9s %7ld samples: mean %7.1f us, p50 %5ld us, p99 %5ld us, p99.9 %5ld us, max %6ld us\n",
+               Tracer::stageName(static_cast<Tracer::Stage>(stage)), static_cast<long>(histogram.count()),
+               histogram.mean(), static_cast<long>(histogram.valueAtPercentile(50)),
+               static_cast<long>(histogram.valueAtPercentile(99)),
+               static_cast<long>(histogram.valueAtPercentile(99.9)), static_cast<long>(histogram.max()));
+    }
+}
+
+int main(int argc, char *argv[]){
+    int requests = argc > 1 ? atoi(argv[1]) : 50000;
+    std::string tracePath = argc > 2 ? argv[2] : "tracebench.json";
+    const int clients = 4;
+
+    EventLoop loop;
+    InetAddress addr(9024);
+    TcpServer server(&loop, addr, "trace");
+    server.setConnectionCallback([](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            conn->setTcpNoDelay(true);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        while(buf->readableBytes() >= kRequestSize){
+            buf->retrieve(kRequestSize);
+            conn->send(kResponse);
+        }
+    });
+    server.setThreadNum(2);
+    server.start();
+
+    std::thread driver([&](){
+        runRound("sampling off", 0, clients, requests);
+        runRound("sampling 1/100", 100, clients, requests);
+        runRound("sampling 1/1", 1, clients, requests);
+        if(Tracer::writeChromeTrace(tracePath)){
+            printf("wrote %s (%zu spans dropped)\n", tracePath.c_str(), Tracer::droppedSpans());
+        }
+        loop.quit();
+    });
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <mymuduo/UdpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Channel.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * UDP接收吞吐测试: 若干发送线程用sendmmsg向本机端口持续发送小数据报
+ *   batch  : UdpServer, 每次可读用recvmmsg收一批
+ *   single : 手写的Channel, 每次可读事件只recvfrom一个数据报
+ * 用法: ./udpbench [batch|single] [数据报大小] [持续秒数] [发送线程数] [gro]
+ */
+
+static std::atomic<bool> g_stop(false);
+
+static void senderThread(const InetAddress &target, size_t size){
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    const int kBatch = 64;
+    std::string payload(size, 'x');
+    mmsghdr msgs[kBatch];
+    iovec iov[kBatch];
+    memset(msgs, 0, sizeof(msgs));
+    for(int i = 0; i < kBatch; ++i){
+        iov[i].iov_base = &payload[0];
+        iov[i].iov_len = size;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = const_cast<sockaddr_in *>(target.getSockAddrInet());
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    while(!g_stop){
+        ::sendmmsg(fd, msgs, kBatch, 0);
+    }
+    ::close(fd);
+}
+
+int main(int argc, char *argv[]){
+    std::string mode = argc > 1 ? argv[1] : "batch";
+    size_t size = argc > 2 ? atoi(argv[2]) : 64;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    int senders = argc > 4 ? atoi(argv[4]) : 2;
+    bool gro = argc > 5 && std::string(argv[5]) == "gro";
+
+    EventLoop loop;
+    InetAddress addr(9005);
+    long packets = 0;
+    long events = 0;
+
+    std::unique_ptr<UdpServer> server;
+    std::unique_ptr<Channel> channel;
+    int fd = -1;
+    if(mode == "batch"){
+        server.reset(new UdpServer(&loop, addr, "udpbench"));
+        if(gro){
+            server->enableGro();
+        }
+        server->setBatchCallback([&](UdpServer *, const UdpPacket *, int count, Timestamp){
+            packets += count;
+            ++events;
+        });
+        server->start();
+    }
+    else{
+        fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        ::bind(fd, addr.getSockAddr(), addr.getSockLen());
+        channel.reset(new Channel(&loop, fd));
+        channel->setReadCallback([&](Timestamp){
+            char buf[2048];
+            if(::recvfrom(fd, buf, sizeof(buf), 0, nullptr, nullptr) >= 0){
+                ++packets;
+            }
+            ++events;
+        });
+        channel->enableReading();
+    }
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < senders; ++i){
+        threads.emplace_back(senderThread, addr, size);
+    }
+    auto start = std::chrono::steady_clock::now();
+    loop.runAfter(seconds, [&](){
+        g_stop = true;
+        loop.quit();
+    });
+    loop.loop();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for(std::thread &t : threads){
+        t.join();
+    }
+
+    printf("%s%s: %ld packets in %.2f s, %.0f packets/s, %.1f packets per read event\n",
+           mode.c_str(), gro ? "+gro" : "", packets, elapsed, packets / elapsed,
+           events > 0 ? static_cast<double>(packets) / events : 0.0);
+    if(channel){
+        channel->disableAll();
+        channel->remove();
+        ::close(fd);
+    }
+    return 0;
+}
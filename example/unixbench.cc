@@ -0,0 +1,106 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/logger.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * 同一TcpServer分别监听环回TCP与Unix域socket,比较回显的延迟与吞吐
+ *   延迟: 64字节消息一问一答
+ *   吞吐: 64KB数据块一问一答
+ * 用法: ./unixbench [往返次数]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static bool writeAll(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len){
+    while(len > 0){
+        ssize_t n = ::read(fd, data, len);
+        if(n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 返回每次往返的平均耗时(微秒)
+static double pingPong(const InetAddress &addr, size_t size, int rounds){
+    int fd = ::socket(addr.family(), SOCK_STREAM, 0);
+    if(::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0){
+        perror("connect");
+        return -1;
+    }
+    if(!addr.isUnix()){
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    std::string message(size, 'x');
+    std::string reply(size, '\0');
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < rounds; ++i){
+        if(!writeAll(fd, message.data(), size) || !readAll(fd, &reply[0], size)){
+            fprintf(stderr, "connection broken\n");
+            break;
+        }
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+    ::close(fd);
+    return us;
+}
+
+int main(int argc, char *argv[]){
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+
+    EventLoop loop;
+    InetAddress tcpAddr(9006);
+    InetAddress unixAddr = InetAddress::unixAddress("/tmp/mymuduo-unixbench.sock");
+
+    MessageCallback echo = [](const TcpConnectionPtr &conn, Buffer *buf, Timestamp){
+        conn->send(buf);
+    };
+    ConnectionCallback onConnection = [](const TcpConnectionPtr &conn){
+        if(conn->connected()){
+            conn->setTcpNoDelay(true); // Unix域socket上设置失败,无影响
+        }
+    };
+    TcpServer tcpServer(&loop, tcpAddr, "tcp-echo");
+    TcpServer unixServer(&loop, unixAddr, "unix-echo");
+    for(TcpServer *server : {&tcpServer, &unixServer}){
+        server->setMessageCallback(echo);
+        server->setConnectionCallback(onConnection);
+        server->setThreadNum(1);
+        server->start();
+    }
+
+    std::thread client([&](){
+        const size_t kSmall = 64;
+        const size_t kLarge = 64 * 1024;
+        for(const InetAddress *addr : {&tcpAddr, &unixAddr}){
+            double latency = pingPong(*addr, kSmall, rounds);
+            double bulk = pingPong(*addr, kLarge, rounds / 10);
+            printf("%-40s latency %7.2f us/round trip, throughput %8.1f MiB/s\n",
+                   addr->toIpPort().c_str(), latency, 2.0 * kLarge / bulk * 1e6 / 1024 / 1024);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}